@@ -1,4 +1,4 @@
-QT += quick widgets
+QT += quick quick3d widgets
 
 CONFIG += c++11
 
@@ -7,9 +7,25 @@ CONFIG += c++11
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+        autosavejournal.cpp \
+        depthview.cpp \
         fileio.cpp \
+        gltfbuffer.cpp \
         gltfexport.cpp \
-        main.cpp
+        headlessexport.cpp \
+        jsonstreamwriter.cpp \
+        main.cpp \
+        pixelcanvas.cpp \
+        pixelgrid.cpp \
+        projectformat.cpp \
+        projectparser.cpp \
+        shapelibrary.cpp \
+        strokeengine.cpp \
+        undohistory.cpp \
+        voxelgeometry.cpp \
+        voxelinstancing.cpp \
+        voxelmesher.cpp \
+        workstealingpool.cpp
 
 RESOURCES += qml.qrc
 
@@ -25,5 +41,21 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    autosavejournal.h \
+    depthview.h \
     fileio.h \
-    gltfexport.h
+    gltfbuffer.h \
+    gltfexport.h \
+    headlessexport.h \
+    jsonstreamwriter.h \
+    pixelcanvas.h \
+    pixelgrid.h \
+    projectformat.h \
+    projectparser.h \
+    shapelibrary.h \
+    strokeengine.h \
+    undohistory.h \
+    voxelgeometry.h \
+    voxelinstancing.h \
+    voxelmesher.h \
+    workstealingpool.h
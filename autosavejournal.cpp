@@ -0,0 +1,376 @@
+#include "autosavejournal.h"
+
+namespace {
+const quint32 kMagic = 0x4A4D4D50;  // "PMMJ"
+const quint16 kVersion = 1;
+const quint8 kGridRecord = 'G';
+const quint8 kPaletteRecord = 'P';
+const quint8 kCellsRecord = 'C';
+// how often the compaction conditions are checked
+const int kCheckInterval = 30 * 1000;
+const int kMaxSide = 16384;
+
+QDataStream &littleEndian(QDataStream &stream) {
+  stream.setByteOrder(QDataStream::LittleEndian);
+  return stream;
+}
+
+QLockFile *journalLock(const QString &fileName) {
+  QLockFile *lock = new QLockFile(fileName + ".lock");
+  // only the lock of an instance that is gone counts as stale
+  lock->setStaleLockTime(0);
+  return lock;
+}
+}  // namespace
+
+AutosaveJournal::AutosaveJournal(QObject *parent) : QObject(parent) {
+  m_timer.setInterval(kCheckInterval);
+  connect(&m_timer, &QTimer::timeout, this,
+          &AutosaveJournal::checkCompaction);
+  if (QCoreApplication::instance()) {
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+            this, &AutosaveJournal::close);
+  }
+}
+
+AutosaveJournal::~AutosaveJournal() { m_journal.close(); }
+
+void AutosaveJournal::open(QUrl project, bool saved) {
+  if (!m_grid) return;
+
+  // a journal in use starts over in place, the grid carries its edits over
+  if (!m_journal.isOpen()) {
+    QString fileName = QDir(journalDirectory())
+                           .filePath(QUuid::createUuid().toString(
+                                         QUuid::WithoutBraces) +
+                                     ".journal");
+    if (!lockJournal(fileName)) return;
+    m_journal.setFileName(fileName);
+  }
+  m_project = project;
+  emit projectChanged(project);
+  if (saved) m_savedRevision = m_revision;
+  if (!startJournal() && !m_journal.isOpen()) m_lock.reset();
+}
+
+void AutosaveJournal::compact() {
+  if (!m_journal.isOpen() || !m_dirty) return;
+  if (startJournal()) emit compacted(m_project);
+}
+
+void AutosaveJournal::close() {
+  if (!m_journal.isOpen()) return;
+
+  m_journal.close();
+  m_timer.stop();
+  // unsaved edits stay in the journal, the next start offers them
+  if (m_savedRevision == m_revision) m_journal.remove();
+  m_lock.reset();
+  m_project.clear();
+  emit projectChanged(m_project);
+}
+
+int AutosaveJournal::revision() const { return m_revision; }
+
+void AutosaveJournal::markSaved(int revision) {
+  m_savedRevision = qMax(m_savedRevision, revision);
+}
+
+QVariantList AutosaveJournal::pendingJournals() const {
+  QVariantList journals;
+  QDir dir(journalDirectory());
+  for (const QFileInfo &info :
+       dir.entryInfoList({"*.journal"}, QDir::Files, QDir::Time)) {
+    QString fileName = info.filePath();
+    if (m_journal.isOpen() && fileName == m_journal.fileName()) continue;
+    // journals of running instances are locked
+    QScopedPointer<QLockFile> lock(journalLock(fileName));
+    if (!lock->tryLock()) continue;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) continue;
+    QDataStream stream(&file);
+    QUrl project;
+    if (!readHeader(littleEndian(stream), project)) continue;
+    journals.append(QVariantMap{{"journal", fileName}, {"project", project}});
+  }
+  return journals;
+}
+
+bool AutosaveJournal::recover(QString journal) {
+  if (!m_grid) return false;
+
+  // the current journal must not see the replayed grid as its edits
+  close();
+  if (!lockJournal(journal)) return false;
+  QFile file(journal);
+  if (!file.open(QIODevice::ReadOnly)) {
+    emit failed(file.errorString());
+    m_lock.reset();
+    return false;
+  }
+  QUrl project;
+  qint64 validSize = 0;
+  int records = replay(file, project, validSize);
+  file.close();
+  if (records == 0) {
+    emit failed("Nothing to recover in " + journal);
+    m_lock.reset();
+    return false;
+  }
+
+  // the replayed journal becomes the current one, minus a torn record
+  QFile::resize(journal, validSize);
+  m_journal.setFileName(journal);
+  if (!m_journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+    emit failed(m_journal.errorString());
+    m_lock.reset();
+    return false;
+  }
+  m_project = project;
+  emit projectChanged(project);
+  m_savedRevision = -1;  // the recovered edits aren't saved anywhere else
+  m_baseSize = 0;
+  m_dirty = true;
+  m_sinceCompaction.start();
+  m_timer.start();
+  emit recovered(project, records);
+  return true;
+}
+
+void AutosaveJournal::discard(QString journal) {
+  if (m_journal.isOpen() && journal == m_journal.fileName()) return;
+  QScopedPointer<QLockFile> lock(journalLock(journal));
+  if (lock->tryLock()) QFile::remove(journal);
+}
+
+QString AutosaveJournal::journalDirectory() {
+  QString dir = QStandardPaths::writableLocation(
+                    QStandardPaths::AppDataLocation) +
+                "/journals";
+  QDir().mkpath(dir);
+  return dir;
+}
+
+PixelGrid *AutosaveJournal::grid() const { return m_grid; }
+
+QUrl AutosaveJournal::project() const { return m_project; }
+
+int AutosaveJournal::compactInterval() const { return m_compactInterval; }
+
+qint64 AutosaveJournal::compactThreshold() const {
+  return m_compactThreshold;
+}
+
+void AutosaveJournal::setGrid(PixelGrid *grid) {
+  if (m_grid == grid) return;
+
+  close();
+  if (m_grid) disconnect(m_grid, nullptr, this, nullptr);
+  m_grid = grid;
+  if (m_grid) {
+    connect(m_grid, &PixelGrid::cellsChanged, this,
+            &AutosaveJournal::appendCells);
+    connect(m_grid, &PixelGrid::paletteChanged, this,
+            &AutosaveJournal::appendPalette);
+    connect(m_grid, &PixelGrid::gridChanged, this,
+            &AutosaveJournal::appendGrid);
+  }
+  emit gridChanged(grid);
+}
+
+void AutosaveJournal::setCompactInterval(int compactInterval) {
+  if (m_compactInterval == compactInterval) return;
+
+  m_compactInterval = compactInterval;
+  emit compactIntervalChanged(compactInterval);
+}
+
+void AutosaveJournal::setCompactThreshold(qint64 compactThreshold) {
+  if (m_compactThreshold == compactThreshold) return;
+
+  m_compactThreshold = compactThreshold;
+  emit compactThresholdChanged(compactThreshold);
+}
+
+void AutosaveJournal::appendCells(const QList<int> &cells) {
+  if (!m_journal.isOpen()) return;
+
+  const QByteArray &colors = m_grid->colorPlane();
+  const QByteArray &depths = m_grid->depthPlane();
+  QByteArray record;
+  QDataStream stream(&record, QIODevice::WriteOnly);
+  littleEndian(stream) << kCellsRecord << quint32(cells.size());
+  for (int cell : cells) {
+    stream << quint32(cell) << quint8(colors[cell]) << quint8(depths[cell]);
+  }
+  appendRecord(record);
+}
+
+void AutosaveJournal::appendPalette() {
+  if (!m_journal.isOpen()) return;
+
+  int size = m_grid->palette().size();
+  QByteArray record;
+  QDataStream stream(&record, QIODevice::WriteOnly);
+  littleEndian(stream) << kPaletteRecord << quint16(size);
+  for (int i = 0; i < size; ++i) {
+    stream << quint32(m_grid->paletteColor(i).rgba());
+  }
+  appendRecord(record);
+}
+
+void AutosaveJournal::appendGrid() {
+  // a clear or fill is cheaper to record as a whole than cell by cell
+  if (m_journal.isOpen()) appendRecord(gridRecord());
+}
+
+void AutosaveJournal::checkCompaction() {
+  if (!m_dirty) return;
+  if (m_journal.size() - m_baseSize >= m_compactThreshold ||
+      m_sinceCompaction.elapsed() >= m_compactInterval) {
+    compact();
+  }
+}
+
+QByteArray AutosaveJournal::gridRecord() const {
+  QByteArray record;
+  QDataStream stream(&record, QIODevice::WriteOnly);
+  int size = m_grid->palette().size();
+  littleEndian(stream) << kGridRecord << quint32(m_grid->width())
+                       << quint32(m_grid->height()) << quint16(size);
+  for (int i = 0; i < size; ++i) {
+    stream << quint32(m_grid->paletteColor(i).rgba());
+  }
+  const QByteArray &colors = m_grid->colorPlane();
+  const QByteArray &depths = m_grid->depthPlane();
+  stream.writeRawData(colors.constData(), colors.size());
+  stream.writeRawData(depths.constData(), depths.size());
+  return record;
+}
+
+bool AutosaveJournal::startJournal() {
+  QString fileName = m_journal.fileName();
+  QByteArray head;
+  QDataStream stream(&head, QIODevice::WriteOnly);
+  littleEndian(stream) << kMagic << kVersion << quint16(0)
+                       << m_project.toString();
+  head.append(gridRecord());
+
+  // a crash while starting over leaves the previous journal in place
+  QSaveFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly) || file.write(head) != head.size() ||
+      !file.commit()) {
+    emit failed(file.errorString());
+    return false;
+  }
+
+  m_journal.close();
+  if (!m_journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+    emit failed(m_journal.errorString());
+    return false;
+  }
+  m_baseSize = head.size();
+  m_dirty = false;
+  m_sinceCompaction.start();
+  m_timer.start();
+  return true;
+}
+
+bool AutosaveJournal::lockJournal(const QString &fileName) {
+  QScopedPointer<QLockFile> lock(journalLock(fileName));
+  if (!lock->tryLock()) {
+    emit failed(fileName + " is used by another instance");
+    return false;
+  }
+  m_lock.swap(lock);
+  return true;
+}
+
+int AutosaveJournal::replay(QFile &file, QUrl &project, qint64 &validSize) {
+  QDataStream stream(&file);
+  if (!readHeader(littleEndian(stream), project)) {
+    qWarning() << "Ignoring journal" << file.fileName();
+    return 0;
+  }
+
+  int records = 0;
+  while (!stream.atEnd()) {
+    quint8 type;
+    stream >> type;
+    if (records == 0 && type != kGridRecord) break;
+    if (type == kGridRecord) {
+      quint32 width, height;
+      quint16 size;
+      stream >> width >> height >> size;
+      if (stream.status() != QDataStream::Ok || width == 0 || height == 0 ||
+          width > quint32(kMaxSide) || height > quint32(kMaxSide))
+        break;
+      QVector<QColor> palette;
+      for (int i = 0; i < size; ++i) {
+        quint32 rgba;
+        stream >> rgba;
+        palette.append(QColor::fromRgba(rgba));
+      }
+      int cells = int(width * height);
+      QByteArray colors(cells, Qt::Uninitialized);
+      QByteArray depths(cells, Qt::Uninitialized);
+      if (stream.readRawData(colors.data(), cells) != cells ||
+          stream.readRawData(depths.data(), cells) != cells ||
+          stream.status() != QDataStream::Ok ||
+          !m_grid->assign(width, height, palette, colors, depths))
+        break;
+    } else if (type == kPaletteRecord) {
+      quint16 size;
+      stream >> size;
+      QStringList palette;
+      for (int i = 0; i < size; ++i) {
+        quint32 rgba;
+        stream >> rgba;
+        palette.append(QColor::fromRgba(rgba).name(QColor::HexArgb));
+      }
+      if (stream.status() != QDataStream::Ok) break;
+      m_grid->setPalette(palette);
+    } else if (type == kCellsRecord) {
+      quint32 count;
+      stream >> count;
+      if (stream.status() != QDataStream::Ok ||
+          qint64(count) * 6 > file.bytesAvailable())
+        break;
+      QVector<int> cells(count);
+      QByteArray colors(count, '\0'), depths(count, '\0');
+      for (quint32 i = 0; i < count; ++i) {
+        quint32 cell;
+        quint8 color, depth;
+        stream >> cell >> color >> depth;
+        cells[i] = cell;
+        colors[i] = char(color);
+        depths[i] = char(depth);
+      }
+      if (stream.status() != QDataStream::Ok) break;
+      m_grid->setCellValues(cells, colors, depths);
+    } else {
+      break;
+    }
+    ++records;
+    validSize = file.pos();
+  }
+  return records;
+}
+
+void AutosaveJournal::appendRecord(const QByteArray &record) {
+  ++m_revision;
+  m_dirty = true;
+  // flushed right away so the record survives a crash of the application
+  if (m_journal.write(record) != record.size() || !m_journal.flush())
+    emit failed(m_journal.errorString());
+}
+
+bool AutosaveJournal::readHeader(QDataStream &stream, QUrl &project) {
+  quint32 magic;
+  quint16 version, reserved;
+  QString url;
+  stream >> magic >> version >> reserved >> url;
+  project = QUrl(url);
+  return stream.status() == QDataStream::Ok && magic == kMagic &&
+         version == kVersion;
+}
@@ -0,0 +1,118 @@
+#ifndef AUTOSAVEJOURNAL_H
+#define AUTOSAVEJOURNAL_H
+
+#include <QLockFile>
+#include <QPointer>
+#include <QtCore>
+
+#include "pixelgrid.h"
+
+/* AutosaveJournal keeps a crash safe record of the edits to a grid.
+ *
+ * A journal starts with the full state of the grid and every batch of
+ * changed cells, palette change or bulk change is appended to it as soon as
+ * the grid reports it, so replaying a journal alone restores the latest
+ * state. The journal never touches the project file, saving stays up to
+ * the user. Journals live in the application data directory under a
+ * unique name, each one locked by the instance writing it, so
+ * pendingJournals finds the ones a crash left behind without picking up
+ * those of another running instance.
+ *
+ * Once the journal has grown by compactThreshold bytes, or compactInterval
+ * passed, it is compacted: it starts over from the current state of the
+ * grid. Closing removes the journal if the grid was saved since its last
+ * edit, otherwise it is kept and offered for recovery on the next start.
+ *
+ * Journal layout, little endian: "PMMJ", quint16 version, quint16 reserved,
+ * the project url as QDataStream QString, then records that start with a
+ * type byte:
+ *   'G' quint32 width, quint32 height, quint16 palette size, palette as
+ *       ARGB quint32, color plane and depth plane as in PixelGrid
+ *   'P' quint16 count, count ARGB quint32 palette entries
+ *   'C' quint32 count, count times quint32 cell, quint8 color, quint8 depth
+ * A record cut short by a crash is ignored on replay.
+ */
+class AutosaveJournal : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(AutosaveJournal)
+  Q_PROPERTY(PixelGrid *grid READ grid WRITE setGrid NOTIFY gridChanged)
+  Q_PROPERTY(QUrl project READ project NOTIFY projectChanged)
+  Q_PROPERTY(int compactInterval READ compactInterval WRITE
+                 setCompactInterval NOTIFY compactIntervalChanged)
+  Q_PROPERTY(qint64 compactThreshold READ compactThreshold WRITE
+                 setCompactThreshold NOTIFY compactThresholdChanged)
+
+ public:
+  AutosaveJournal(QObject *parent = 0);
+  ~AutosaveJournal();
+
+  /* starts journaling the grid as project, an empty url for unsaved grids.
+   * saved tells whether the grid matches the project file, as after
+   * loading it, or carries edits over, as before a save as
+   */
+  Q_INVOKABLE void open(QUrl project, bool saved);
+  Q_INVOKABLE void compact();
+  // stops journaling, the journal is kept if there are unsaved edits
+  Q_INVOKABLE void close();
+
+  // counts the edits, a save records the revision it started at
+  Q_INVOKABLE int revision() const;
+  // the project file holds the grid as of revision
+  Q_INVOKABLE void markSaved(int revision);
+
+  // journals left behind by a crash, as {"journal": path, "project": url}
+  Q_INVOKABLE QVariantList pendingJournals() const;
+  // replays a pending journal into the grid and keeps journaling into it
+  Q_INVOKABLE bool recover(QString journal);
+  Q_INVOKABLE void discard(QString journal);
+
+  static QString journalDirectory();
+
+  PixelGrid *grid() const;
+  QUrl project() const;
+  int compactInterval() const;
+  qint64 compactThreshold() const;
+
+ public slots:
+  void setGrid(PixelGrid *grid);
+  void setCompactInterval(int compactInterval);
+  void setCompactThreshold(qint64 compactThreshold);
+
+ signals:
+  void gridChanged(PixelGrid *grid);
+  void projectChanged(QUrl project);
+  void compactIntervalChanged(int compactInterval);
+  void compactThresholdChanged(qint64 compactThreshold);
+  void recovered(QUrl project, int records);
+  void compacted(QUrl project);
+  void failed(QString message);
+
+ private slots:
+  void appendCells(const QList<int> &cells);
+  void appendPalette();
+  void appendGrid();
+  void checkCompaction();
+
+ private:
+  QByteArray gridRecord() const;
+  bool startJournal();
+  bool lockJournal(const QString &fileName);
+  int replay(QFile &file, QUrl &project, qint64 &validSize);
+  void appendRecord(const QByteArray &record);
+  static bool readHeader(QDataStream &stream, QUrl &project);
+
+  QPointer<PixelGrid> m_grid;
+  QUrl m_project;
+  QFile m_journal;
+  QScopedPointer<QLockFile> m_lock;  // held while m_journal is in use
+  qint64 m_baseSize = 0;  // journal size right after it (re)started
+  QTimer m_timer;
+  QElapsedTimer m_sinceCompaction;
+  bool m_dirty = false;  // records were appended since the last compaction
+  int m_revision = 0;
+  int m_savedRevision = 0;  // -1 if the project never held these edits
+  int m_compactInterval = 10 * 60 * 1000;
+  qint64 m_compactThreshold = 256 * 1024;
+};
+
+#endif  // AUTOSAVEJOURNAL_H
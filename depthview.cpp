@@ -0,0 +1,150 @@
+#include "depthview.h"
+
+#include <QFont>
+#include <QPainter>
+
+namespace {
+// alpha of the cell color drawn over the checkerboard
+const qreal kOverlayOpacity = 0.6;
+
+QFont labelFont() {
+  QFont font("Roboto");
+  font.setBold(true);
+  font.setPixelSize(10);
+  return font;
+}
+}  // namespace
+
+DepthView::DepthView(QQuickItem *parent) : QQuickPaintedItem(parent) {}
+
+DepthView::~DepthView() {}
+
+void DepthView::paint(QPainter *painter) {
+  if (!m_grid || m_grid->width() == 0 || m_grid->height() == 0) return;
+
+  QSizeF size = cellSize();
+  updateAtlas(size.toSize());
+
+  // only the cells overlapping the invalidated area are painted
+  QRectF area = painter->clipBoundingRect();
+  if (area.isEmpty()) area = boundingRect();
+  int firstCol = qMax(0, int(area.left() / size.width()));
+  int firstRow = qMax(0, int(area.top() / size.height()));
+  int lastCol = qMin(m_grid->width() - 1, int(area.right() / size.width()));
+  int lastRow = qMin(m_grid->height() - 1, int(area.bottom() / size.height()));
+
+  for (int row = firstRow; row <= lastRow; ++row) {
+    for (int col = firstCol; col <= lastCol; ++col) {
+      QRectF rect(col * size.width(), row * size.height(), size.width(),
+                  size.height());
+      paintCell(painter, row, col, rect);
+    }
+  }
+}
+
+PixelGrid *DepthView::grid() const { return m_grid; }
+
+int DepthView::maxDepth() const { return m_maxDepth; }
+
+QColor DepthView::checkerColor() const { return m_checkerColor; }
+
+QColor DepthView::alternateCheckerColor() const {
+  return m_alternateCheckerColor;
+}
+
+void DepthView::setGrid(PixelGrid *grid) {
+  if (m_grid == grid) return;
+
+  if (m_grid) disconnect(m_grid, nullptr, this, nullptr);
+  m_grid = grid;
+  if (m_grid) {
+    connect(m_grid, &PixelGrid::cellsChanged, this, &DepthView::updateCells);
+    connect(m_grid, &PixelGrid::gridChanged, this, [this]() { update(); });
+    connect(m_grid, &PixelGrid::paletteChanged, this, [this]() { update(); });
+  }
+  update();
+  emit gridChanged(grid);
+}
+
+void DepthView::setMaxDepth(int maxDepth) {
+  if (m_maxDepth == maxDepth) return;
+
+  m_maxDepth = maxDepth;
+  m_atlas = QImage();
+  update();
+  emit maxDepthChanged(maxDepth);
+}
+
+void DepthView::setCheckerColor(QColor color) {
+  if (m_checkerColor == color) return;
+
+  m_checkerColor = color;
+  update();
+  emit checkerChanged();
+}
+
+void DepthView::setAlternateCheckerColor(QColor color) {
+  if (m_alternateCheckerColor == color) return;
+
+  m_alternateCheckerColor = color;
+  update();
+  emit checkerChanged();
+}
+
+void DepthView::updateCells(const QList<int> &cells) {
+  if (!m_grid) return;
+
+  QSizeF size = cellSize();
+  int width = m_grid->width();
+  for (int index : cells) {
+    QRectF rect((index % width) * size.width(), (index / width) * size.height(),
+                size.width(), size.height());
+    update(rect.toAlignedRect());
+  }
+}
+
+QSizeF DepthView::cellSize() const {
+  return QSizeF(width() / m_grid->width(), height() / m_grid->height());
+}
+
+void DepthView::updateAtlas(const QSize &glyphSize) {
+  if (!m_atlas.isNull() && m_glyphSize == glyphSize) return;
+
+  m_glyphSize = glyphSize;
+  m_atlas = QImage(glyphSize.width() * m_maxDepth, glyphSize.height(),
+                   QImage::Format_ARGB32_Premultiplied);
+  if (m_atlas.isNull()) return;
+  m_atlas.fill(Qt::transparent);
+
+  QPainter painter(&m_atlas);
+  painter.setFont(labelFont());
+  painter.setPen(Qt::black);
+  for (int depth = 1; depth <= m_maxDepth; ++depth) {
+    QRect glyph((depth - 1) * glyphSize.width(), 0, glyphSize.width(),
+                glyphSize.height());
+    painter.drawText(glyph, Qt::AlignCenter, QString::number(depth));
+  }
+}
+
+void DepthView::paintCell(QPainter *painter, int row, int col,
+                          const QRectF &rect) {
+  painter->fillRect(rect, (row + col) % 2 ? m_alternateCheckerColor
+                                          : m_checkerColor);
+  if (m_grid->isEmpty(row, col)) return;
+
+  QColor color = m_grid->paletteColor(m_grid->colorIndex(row, col));
+  color.setAlphaF(kOverlayOpacity);
+  painter->fillRect(rect, color);
+
+  int depth = m_grid->depth(row, col);
+  if (depth >= 1 && depth <= m_maxDepth && !m_atlas.isNull()) {
+    QRectF glyph((depth - 1) * m_glyphSize.width(), 0, m_glyphSize.width(),
+                 m_glyphSize.height());
+    painter->drawImage(QRectF(rect.topLeft(), m_glyphSize), m_atlas, glyph);
+  } else {
+    // depths beyond the atlas can only come from loaded files
+    painter->setFont(labelFont());
+    painter->setPen(Qt::black);
+    painter->drawText(rect, Qt::AlignCenter, QString::number(depth));
+  }
+}
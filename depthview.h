@@ -0,0 +1,63 @@
+#ifndef DEPTHVIEW_H
+#define DEPTHVIEW_H
+
+#include <QImage>
+#include <QPointer>
+#include <QQuickPaintedItem>
+
+#include "pixelgrid.h"
+
+/* DepthView paints the depth of every cell as a label over a translucent
+ * version of its color. The labels 1..maxDepth are rendered once into a
+ * glyph atlas whenever the cell size changes and are blitted from there,
+ * and grid edits only invalidate the rectangles of the dirty cells.
+ */
+class DepthView : public QQuickPaintedItem {
+  Q_OBJECT
+  Q_PROPERTY(PixelGrid *grid READ grid WRITE setGrid NOTIFY gridChanged)
+  Q_PROPERTY(int maxDepth READ maxDepth WRITE setMaxDepth NOTIFY
+                 maxDepthChanged)
+  Q_PROPERTY(QColor checkerColor READ checkerColor WRITE setCheckerColor
+                 NOTIFY checkerChanged)
+  Q_PROPERTY(QColor alternateCheckerColor READ alternateCheckerColor WRITE
+                 setAlternateCheckerColor NOTIFY checkerChanged)
+
+ public:
+  DepthView(QQuickItem *parent = 0);
+  ~DepthView();
+
+  void paint(QPainter *painter) override;
+
+  PixelGrid *grid() const;
+  int maxDepth() const;
+  QColor checkerColor() const;
+  QColor alternateCheckerColor() const;
+
+ public slots:
+  void setGrid(PixelGrid *grid);
+  void setMaxDepth(int maxDepth);
+  void setCheckerColor(QColor color);
+  void setAlternateCheckerColor(QColor color);
+
+ signals:
+  void gridChanged(PixelGrid *grid);
+  void maxDepthChanged(int maxDepth);
+  void checkerChanged();
+
+ private slots:
+  void updateCells(const QList<int> &cells);
+
+ private:
+  QSizeF cellSize() const;
+  void updateAtlas(const QSize &glyphSize);
+  void paintCell(QPainter *painter, int row, int col, const QRectF &rect);
+
+  QPointer<PixelGrid> m_grid;
+  int m_maxDepth = 8;
+  QColor m_checkerColor = QColor(230, 230, 230);
+  QColor m_alternateCheckerColor = QColor(217, 217, 217);
+  QImage m_atlas;  // glyphs for 1..m_maxDepth side by side
+  QSize m_glyphSize;
+};
+
+#endif  // DEPTHVIEW_H
@@ -1,9 +1,79 @@
 #include "fileio.h"
 #include <QFileDialog>
 
+#include "pixelgrid.h"
+#include "projectformat.h"
+
+namespace {
+// files are read and written in blocks of this size to report progress
+const qint64 kBlockSize = 1024 * 1024;
+
+// a copy of a grid that can be handed to another thread
+struct GridSnapshot {
+  int width = 0;
+  int height = 0;
+  QVector<QColor> palette;
+  QByteArray colors;
+  QByteArray depths;
+  QString jsonVersion;
+};
+
+GridSnapshot takeSnapshot(const PixelGrid &grid) {
+  GridSnapshot snapshot;
+  snapshot.width = grid.width();
+  snapshot.height = grid.height();
+  for (int i = 0; i < grid.palette().size(); ++i) {
+    snapshot.palette.append(grid.paletteColor(i));
+  }
+  snapshot.colors = grid.colorPlane();
+  snapshot.depths = grid.depthPlane();
+  snapshot.jsonVersion = grid.jsonVersion();
+  return snapshot;
+}
+}  // namespace
+
+struct FileIO::Job {
+  QPointer<FileIO> owner;
+  QUrl source;
+  QAtomicInt canceled;
+  // reads hand the file to work in blocks, unless work opens it itself
+  bool opensFile = false;
+  // runs on the worker thread, produces the data to write or consumes the
+  // data that was read. returns an error message or an empty string
+  std::function<QString(QByteArray &data)> work;
+  // runs on the gui thread once a read succeeded
+  std::function<void()> done;
+  // set by the worker once a write is over, with its error in result
+  QSemaphore finished;
+  QString result;
+  bool reported = false;  // finishWrite ran for it, gui thread only
+};
+
+QHash<QString, FileIO::WriteSlot> FileIO::s_writeSlots;
+
 FileIO::FileIO(QObject *parent) : QObject(parent) {}
 
-FileIO::~FileIO() {}
+FileIO::~FileIO() {
+  /* reads are of no use any more, but saves have to reach the disk. they
+   * are waited for instead of left to finish in the background, since a
+   * queued save is started from the event loop, which is gone on quit
+   */
+  QSet<QString> files;
+  for (const JobPointer &job : m_jobs) {
+    QString fileName = job->source.toLocalFile();
+    auto slot = s_writeSlots.constFind(fileName);
+    bool write = slot != s_writeSlots.constEnd() &&
+                 (slot->running == job || slot->queued == job);
+    if (write) {
+      files.insert(fileName);
+    } else {
+      job->canceled.storeRelaxed(1);
+    }
+    job->owner = nullptr;  // nobody is left to report to
+  }
+  m_jobs.clear();
+  for (const QString &fileName : files) waitForWrites(fileName);
+}
 
 void FileIO::read() {
   if (m_source.isEmpty()) {
@@ -25,11 +95,16 @@ void FileIO::write() {
   if (m_source.isEmpty()) {
     return;
   }
-  QFile file(m_source.toLocalFile());
+  // the old file stays in place until the new one is complete
+  QSaveFile file(m_source.toLocalFile());
   if (file.open(QIODevice::WriteOnly)) {
     QTextStream stream(&file);
     stream << m_text;
+    stream.flush();
+    if (file.commit()) return;
   }
+  qWarning() << "Can't write" << m_source.toLocalFile() << file.errorString();
+  emit error(file.errorString());
 }
 
 void FileIO::reset()
@@ -38,6 +113,299 @@ void FileIO::reset()
     m_text = "";
 }
 
+bool FileIO::readProject(PixelGrid *grid) {
+  if (m_source.isEmpty() || !grid) {
+    return false;
+  }
+  QString message;
+  if (!ProjectFormat::read(m_source.toLocalFile(), *grid, &message)) {
+    qWarning() << "Can't read" << m_source.toLocalFile() << message;
+    emit error(message);
+    return false;
+  }
+  return true;
+}
+
+bool FileIO::writeProject(PixelGrid *grid) {
+  if (m_source.isEmpty() || !grid) {
+    return false;
+  }
+  QString message;
+  if (!ProjectFormat::write(m_source.toLocalFile(), *grid, &message)) {
+    qWarning() << "Can't write" << m_source.toLocalFile() << message;
+    emit error(message);
+    return false;
+  }
+  return true;
+}
+
+bool FileIO::convert(QUrl source, QUrl target) {
+  QString message;
+  if (!ProjectFormat::convert(source.toLocalFile(), target.toLocalFile(),
+                              &message)) {
+    qWarning() << "Can't convert" << source.toLocalFile() << message;
+    emit error(message);
+    return false;
+  }
+  return true;
+}
+
+void FileIO::readAsync() {
+  if (m_source.isEmpty()) {
+    return;
+  }
+  JobPointer job(new Job);
+  auto text = QSharedPointer<QString>::create();
+  job->work = [text](QByteArray &data) {
+    *text = QString::fromUtf8(data);
+    return QString();
+  };
+  job->done = [this, text]() {
+    m_text = *text;
+    emit textChanged(m_text);
+  };
+  startRead(job);
+}
+
+void FileIO::writeAsync() {
+  if (m_source.isEmpty()) {
+    return;
+  }
+  JobPointer job(new Job);
+  QByteArray text = m_text.toUtf8();
+  job->work = [text](QByteArray &data) {
+    data = text;
+    return QString();
+  };
+  queueWrite(job);
+}
+
+void FileIO::readProjectAsync(PixelGrid *grid) {
+  if (m_source.isEmpty() || !grid) {
+    return;
+  }
+  /* the mapped file is parsed into a grid owned by the worker, only the
+   * finished planes are moved into the target grid on the gui thread. the
+   * planes are shared, so that move doesn't copy them either
+   */
+  JobPointer job(new Job);
+  job->opensFile = true;
+  QString fileName = m_source.toLocalFile();
+  auto snapshot = QSharedPointer<GridSnapshot>::create();
+  auto elapsed = QSharedPointer<qint64>::create(0);
+  job->work = [fileName, snapshot, elapsed](QByteArray &) {
+    QElapsedTimer timer;
+    timer.start();
+    PixelGrid parsed;
+    QString message;
+    if (ProjectFormat::read(fileName, parsed, &message))
+      *snapshot = takeSnapshot(parsed);
+    *elapsed = timer.elapsed();
+    return message;
+  };
+  QPointer<PixelGrid> target(grid);
+  job->done = [this, target, snapshot, elapsed]() {
+    if (target) {
+      target->assign(snapshot->width, snapshot->height, snapshot->palette,
+                     snapshot->colors, snapshot->depths);
+      target->setJsonVersion(snapshot->jsonVersion);
+    }
+    m_parseTime = *elapsed;
+    emit parseTimeChanged(m_parseTime);
+  };
+  startRead(job);
+}
+
+void FileIO::writeProjectAsync(PixelGrid *grid) {
+  if (m_source.isEmpty() || !grid) {
+    return;
+  }
+  // the planes are shared copy on write, encoding happens on the worker
+  JobPointer job(new Job);
+  QString fileName = m_source.toLocalFile();
+  GridSnapshot snapshot = takeSnapshot(*grid);
+  job->work = [fileName, snapshot](QByteArray &data) {
+    PixelGrid copy;
+    if (!copy.assign(snapshot.width, snapshot.height, snapshot.palette,
+                     snapshot.colors, snapshot.depths)) {
+      return QString("Nothing to save");
+    }
+    copy.setJsonVersion(snapshot.jsonVersion);
+    data = ProjectFormat::formatForFile(fileName) == ProjectFormat::Binary
+               ? ProjectFormat::toBinary(copy)
+               : ProjectFormat::toJson(copy);
+    return QString();
+  };
+  queueWrite(job);
+}
+
+void FileIO::cancel() {
+  for (const JobPointer &job : m_jobs) {
+    job->canceled.storeRelaxed(1);
+    // a write that hasn't started yet is simply dropped
+    auto slot = s_writeSlots.find(job->source.toLocalFile());
+    if (slot != s_writeSlots.end() && slot->queued == job) slot->queued.reset();
+  }
+  m_jobs.clear();
+}
+
+void FileIO::startRead(JobPointer job) {
+  job->owner = this;
+  job->source = m_source;
+  m_jobs.append(job);
+
+  QThreadPool::globalInstance()->start([job]() {
+    QString message;
+    QByteArray data;
+    QFile file(job->source.toLocalFile());
+    if (job->opensFile) {
+      // work accesses the file itself, there is no read progress
+    } else if (!file.open(QIODevice::ReadOnly)) {
+      message = file.errorString();
+    } else {
+      qint64 total = file.size();
+      while (!file.atEnd() && !job->canceled.loadRelaxed()) {
+        QByteArray block = file.read(kBlockSize);
+        if (block.isEmpty()) {
+          message = file.errorString();
+          break;
+        }
+        data.append(block);
+        qint64 done = data.size();
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [job, done, total]() {
+              if (job->owner) job->owner->reportProgress(done, total);
+            },
+            Qt::QueuedConnection);
+      }
+    }
+    if (message.isEmpty() && !job->canceled.loadRelaxed())
+      message = job->work(data);
+
+    QMetaObject::invokeMethod(
+        QCoreApplication::instance(),
+        [job, message]() {
+          FileIO *owner = job->owner;
+          if (!owner || job->canceled.loadRelaxed()) return;
+          owner->m_jobs.removeOne(job);
+          if (!message.isEmpty()) {
+            emit owner->failed(job->source, message);
+            return;
+          }
+          job->done();
+          emit owner->readFinished(job->source);
+        },
+        Qt::QueuedConnection);
+  });
+}
+
+void FileIO::queueWrite(JobPointer job) {
+  job->owner = this;
+  job->source = m_source;
+  m_jobs.append(job);
+
+  WriteSlot &slot = s_writeSlots[m_source.toLocalFile()];
+  if (slot.running) {
+    // replaces an older save still waiting for this file
+    if (slot.queued) {
+      JobPointer superseded = slot.queued;
+      FileIO *owner = superseded->owner;
+      if (owner) {
+        owner->m_jobs.removeOne(superseded);
+        emit owner->superseded(superseded->source);
+      }
+    }
+    slot.queued = job;
+    return;
+  }
+  slot.running = job;
+  startWrite(job);
+}
+
+void FileIO::startWrite(JobPointer job) {
+  QThreadPool::globalInstance()->start([job]() {
+    QByteArray data;
+    QString message = job->work(data);
+    if (message.isEmpty() && !job->canceled.loadRelaxed()) {
+      // QSaveFile only replaces the file once everything is written
+      QSaveFile file(job->source.toLocalFile());
+      if (!file.open(QIODevice::WriteOnly)) {
+        message = file.errorString();
+      }
+      qint64 total = data.size();
+      for (qint64 done = 0; message.isEmpty() && done < total;) {
+        if (job->canceled.loadRelaxed()) {
+          file.cancelWriting();
+          break;
+        }
+        qint64 written = file.write(data.constData() + done,
+                                    qMin(kBlockSize, total - done));
+        if (written < 0) {
+          message = file.errorString();
+          break;
+        }
+        done += written;
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [job, done, total]() {
+              if (job->owner) job->owner->reportProgress(done, total);
+            },
+            Qt::QueuedConnection);
+      }
+      if (message.isEmpty() && !job->canceled.loadRelaxed() && !file.commit())
+        message = file.errorString();
+    }
+
+    job->result = message;
+    job->finished.release();
+    QMetaObject::invokeMethod(
+        QCoreApplication::instance(), [job]() { finishWrite(job); },
+        Qt::QueuedConnection);
+  });
+}
+
+void FileIO::waitForWrites(const QString &fileName) {
+  // finishes the writes here, the queued finishWrite calls become no-ops
+  for (;;) {
+    auto slot = s_writeSlots.constFind(fileName);
+    if (slot == s_writeSlots.constEnd() || !slot->running) return;
+    JobPointer job = slot->running;
+    job->finished.acquire();
+    job->finished.release();
+    finishWrite(job);
+  }
+}
+
+void FileIO::finishWrite(JobPointer job) {
+  if (job->reported) return;
+  job->reported = true;
+  QString message = job->result;
+  QString fileName = job->source.toLocalFile();
+  WriteSlot &slot = s_writeSlots[fileName];
+  slot.running.reset();
+  if (slot.queued) {
+    slot.running = slot.queued;
+    slot.queued.reset();
+    startWrite(slot.running);
+  } else {
+    s_writeSlots.remove(fileName);
+  }
+
+  FileIO *owner = job->owner;
+  if (!owner || job->canceled.loadRelaxed()) return;
+  owner->m_jobs.removeOne(job);
+  if (message.isEmpty()) {
+    emit owner->writeFinished(job->source);
+  } else {
+    emit owner->failed(job->source, message);
+  }
+}
+
+void FileIO::reportProgress(qint64 bytesDone, qint64 bytesTotal) {
+  emit progress(bytesDone, bytesTotal);
+}
+
 QUrl FileIO::source() const
 {
     return m_source;
@@ -48,6 +416,11 @@ QString FileIO::text() const
     return m_text;
 }
 
+qint64 FileIO::parseTime() const
+{
+    return m_parseTime;
+}
+
 void FileIO::setSource(QUrl source) {
   if (m_source == source)
     return;
@@ -3,11 +3,25 @@
 
 #include <QtCore>
 
+class PixelGrid;
+
+/* FileIO reads and writes text files and projects for QML.
+ *
+ * The *Async variants do the file access, and for projects the encoding and
+ * parsing, on a worker thread and report through readFinished,
+ * writeFinished, progress and failed. Only one write per file runs at a
+ * time, across all FileIO objects; a save requested while one is running
+ * is queued and replaces any save already waiting for that file, which then
+ * reports superseded. Destroying a FileIO drops its reads but waits for
+ * its saves.
+ */
 class FileIO : public QObject {
   Q_OBJECT
   Q_DISABLE_COPY(FileIO)
   Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged)
   Q_PROPERTY(QString text READ text WRITE setText NOTIFY textChanged)
+  // milliseconds the last readProjectAsync took to map and parse the file
+  Q_PROPERTY(qint64 parseTime READ parseTime NOTIFY parseTimeChanged)
 public:
   FileIO(QObject *parent = 0);
   ~FileIO();
@@ -16,18 +30,58 @@ public:
   Q_INVOKABLE void write();
   Q_INVOKABLE void reset();
 
+  // projects in the format matching the suffix of source, see ProjectFormat
+  Q_INVOKABLE bool readProject(PixelGrid *grid);
+  Q_INVOKABLE bool writeProject(PixelGrid *grid);
+  Q_INVOKABLE bool convert(QUrl source, QUrl target);
+
+  Q_INVOKABLE void readAsync();
+  Q_INVOKABLE void writeAsync();
+  Q_INVOKABLE void readProjectAsync(PixelGrid *grid);
+  Q_INVOKABLE void writeProjectAsync(PixelGrid *grid);
+  // stops the reads and writes started by this object, writes in progress
+  // leave the existing file untouched
+  Q_INVOKABLE void cancel();
+  // blocks until every save of fileName, from any FileIO, is on disk
+  static void waitForWrites(const QString &fileName);
+
   QUrl source() const;
   QString text() const;
+  qint64 parseTime() const;
 public slots:
   void setSource(QUrl source);
   void setText(QString text);
 signals:
   void sourceChanged(QUrl arg);
   void textChanged(QString arg);
+  void parseTimeChanged(qint64 parseTime);
+  void error(QString message);
+  void readFinished(QUrl source);
+  void writeFinished(QUrl source);
+  void progress(qint64 bytesDone, qint64 bytesTotal);
+  void failed(QUrl source, QString message);
+  // a save that never ran, a newer one for the same file replaced it
+  void superseded(QUrl source);
 
 private:
+  struct Job;
+  using JobPointer = QSharedPointer<Job>;
+  struct WriteSlot {
+    JobPointer running;
+    JobPointer queued;
+  };
+
+  void startRead(JobPointer job);
+  void queueWrite(JobPointer job);
+  static void startWrite(JobPointer job);
+  static void finishWrite(JobPointer job);
+  void reportProgress(qint64 bytesDone, qint64 bytesTotal);
+
   QUrl m_source;
   QString m_text;
+  qint64 m_parseTime = 0;
+  QList<JobPointer> m_jobs;  // started by this object and not finished yet
+  static QHash<QString, WriteSlot> s_writeSlots;  // per file, gui thread only
 };
 
 #endif // FILEIO_H
@@ -0,0 +1,109 @@
+#include "gltfbuffer.h"
+
+#include <QtEndian>
+#include <limits>
+
+const char GLTFBuffer::kDataUriPrefix[] =
+    "data:application/octet-stream;base64,";
+
+int GLTFBuffer::addBufferView(const QByteArray &data, Target target) {
+  // every view starts on a 4 byte boundary so any component type can follow
+  while (m_data.size() % 4) m_data.append('\0');
+
+  QJsonObject view{{"buffer", 0},
+                   {"byteOffset", m_data.size()},
+                   {"byteLength", data.size()}};
+  if (target != NoTarget) view.insert("target", target);
+  m_data.append(data);
+  m_bufferViews.append(view);
+  return m_bufferViews.size() - 1;
+}
+
+int GLTFBuffer::addAccessor(int bufferView, ComponentType componentType,
+                            int count, const QString &type,
+                            const QJsonArray &min, const QJsonArray &max) {
+  QJsonObject accessor{{"bufferView", bufferView},
+                       {"componentType", componentType},
+                       {"count", count},
+                       {"type", type}};
+  if (!min.isEmpty()) accessor.insert("min", min);
+  if (!max.isEmpty()) accessor.insert("max", max);
+  m_accessors.append(accessor);
+  return m_accessors.size() - 1;
+}
+
+int GLTFBuffer::appendBuffer(const QByteArray &data,
+                             const QJsonArray &bufferViews,
+                             const QJsonArray &accessors) {
+  /* appends a complete buffer of another glTF file, its bufferViews and
+   * accessors are rebased onto this buffer. returns the index of its first
+   * accessor
+   */
+  while (m_data.size() % 4) m_data.append('\0');
+  int byteBase = m_data.size();
+  int viewBase = m_bufferViews.size();
+  int accessorBase = m_accessors.size();
+  m_data.append(data);
+
+  for (const QJsonValue &value : bufferViews) {
+    QJsonObject view = value.toObject();
+    view.insert("buffer", 0);
+    view.insert("byteOffset", view.value("byteOffset").toInt() + byteBase);
+    m_bufferViews.append(view);
+  }
+  for (const QJsonValue &value : accessors) {
+    QJsonObject accessor = value.toObject();
+    if (accessor.contains("bufferView")) {
+      accessor.insert("bufferView",
+                      accessor.value("bufferView").toInt() + viewBase);
+    }
+    m_accessors.append(accessor);
+  }
+  return accessorBase;
+}
+
+int GLTFBuffer::addVec3Accessor(const QVector<float> &values, Target target,
+                                bool withBounds) {
+  /* POSITION accessors must carry min and max, so they are computed here
+   * while the values are copied into little endian order
+   */
+  QByteArray data(values.size() * sizeof(float), Qt::Uninitialized);
+  float min[3] = {std::numeric_limits<float>::max(),
+                  std::numeric_limits<float>::max(),
+                  std::numeric_limits<float>::max()};
+  float max[3] = {std::numeric_limits<float>::lowest(),
+                  std::numeric_limits<float>::lowest(),
+                  std::numeric_limits<float>::lowest()};
+  for (int i = 0; i < values.size(); ++i) {
+    qToLittleEndian(values[i], data.data() + i * sizeof(float));
+    min[i % 3] = qMin(min[i % 3], values[i]);
+    max[i % 3] = qMax(max[i % 3], values[i]);
+  }
+
+  int view = addBufferView(data, target);
+  if (!withBounds || values.isEmpty()) {
+    return addAccessor(view, Float, values.size() / 3, "VEC3");
+  }
+  return addAccessor(view, Float, values.size() / 3, "VEC3",
+                     QJsonArray{min[0], min[1], min[2]},
+                     QJsonArray{max[0], max[1], max[2]});
+}
+
+int GLTFBuffer::addIndexAccessor(const QVector<quint32> &indices,
+                                 int vertexCount) {
+  // use 16 bit indices whenever the referenced vertices allow it
+  bool shortIndices = vertexCount <= std::numeric_limits<quint16>::max();
+  int componentSize = shortIndices ? sizeof(quint16) : sizeof(quint32);
+  QByteArray data(indices.size() * componentSize, Qt::Uninitialized);
+  for (int i = 0; i < indices.size(); ++i) {
+    if (shortIndices) {
+      qToLittleEndian(quint16(indices[i]), data.data() + i * componentSize);
+    } else {
+      qToLittleEndian(indices[i], data.data() + i * componentSize);
+    }
+  }
+
+  int view = addBufferView(data, ElementArrayBuffer);
+  return addAccessor(view, shortIndices ? UnsignedShort : UnsignedInt,
+                     indices.size(), "SCALAR");
+}
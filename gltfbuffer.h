@@ -0,0 +1,49 @@
+#ifndef GLTFBUFFER_H
+#define GLTFBUFFER_H
+
+#include <QtCore>
+
+/* GLTFBuffer collects the binary payload of an export together with the
+ * bufferViews and accessors that point into it, so every part of the
+ * exporter can append data without tracking offsets by hand.
+ */
+class GLTFBuffer {
+ public:
+  // prefix of buffers embedded in a .gltf file as base64 data uris
+  static const char kDataUriPrefix[];
+
+  enum ComponentType {
+    UnsignedShort = 5123,
+    UnsignedInt = 5125,
+    Float = 5126,
+  };
+
+  enum Target {
+    NoTarget = 0,
+    ArrayBuffer = 34962,
+    ElementArrayBuffer = 34963,
+  };
+
+  int addBufferView(const QByteArray &data, Target target = NoTarget);
+  int addAccessor(int bufferView, ComponentType componentType, int count,
+                  const QString &type, const QJsonArray &min = QJsonArray(),
+                  const QJsonArray &max = QJsonArray());
+
+  int appendBuffer(const QByteArray &data, const QJsonArray &bufferViews,
+                   const QJsonArray &accessors);
+
+  int addVec3Accessor(const QVector<float> &values, Target target,
+                      bool withBounds);
+  int addIndexAccessor(const QVector<quint32> &indices, int vertexCount);
+
+  const QByteArray &data() const { return m_data; }
+  QJsonArray bufferViews() const { return m_bufferViews; }
+  QJsonArray accessors() const { return m_accessors; }
+
+ private:
+  QByteArray m_data;
+  QJsonArray m_bufferViews;
+  QJsonArray m_accessors;
+};
+
+#endif  // GLTFBUFFER_H
@@ -2,60 +2,307 @@
 
 #include <QColor>
 #include <QJsonObject>
+#include <QtEndian>
 
-GLTFExport::GLTFExport(QObject *) {}
+#include "gltfbuffer.h"
+#include "jsonstreamwriter.h"
+#include "pixelgrid.h"
+#include "voxelmesher.h"
 
-GLTFExport::~GLTFExport() {}
+namespace {
+const quint32 kGlbMagic = 0x46546C67;      // "glTF"
+const quint32 kGlbVersion = 2;
+const quint32 kGlbChunkJson = 0x4E4F534A;  // "JSON"
+const quint32 kGlbChunkBin = 0x004E4942;   // "BIN\0"
+
+/* size of one pixel in glTF units, matches the [-1, 1] cube of the shape
+ * files and the translations written by insertNodes
+ */
+const float kCellSize = 2.0f;
+
+// vertices and triangles of the cube shape, used to report the savings
+const int kCubeVertices = 24;
+const int kCubeTriangles = 12;
+
+const QString kInstancingExtension = "EXT_mesh_gpu_instancing";
+
+// nodes written between two cancel checks
+const int kNodeBatch = 1024;
+// Writing steps the buffer is reported in, whatever its size
+const int kBufferSteps = 100;
+
+void appendUInt32(QByteArray &data, quint32 value) {
+  quint32 le = qToLittleEndian(value);
+  data.append(reinterpret_cast<const char *>(&le), sizeof(le));
+}
+}  // namespace
+
+GLTFExport::GLTFExport(QObject *parent) : QObject(parent) {
+  // exports run one after the other
+  m_pool.setMaxThreadCount(1);
+}
+
+GLTFExport::~GLTFExport() {
+  cancel();
+  m_pool.waitForDone();
+}
 
 void GLTFExport::write(QUrl fileName, QJsonObject data) {
-  QString version = data.take("version").toString();
   QString localFileName = fileName.toLocalFile();
-  if (version != "1.0") {
-    emit error(localFileName,
-               "Invalid version number [1.0 != " + version + "]");
-    return;
+  Mode mode = m_mode;
+  int generation = m_generation.loadRelaxed();
+  if (m_pending++ == 0) emit busyChanged(true);
+
+  m_pool.start([this, localFileName, data, mode, generation]() {
+    m_jobFileName = localFileName;
+    m_jobGeneration = generation;
+    m_jobReportsProgress = true;
+    m_jobStage = -1;
+    Result result;
+    if (isCanceled()) {
+      result.canceled = true;
+    } else {
+      result = exportModel(localFileName, data, mode);
+    }
+
+    QMetaObject::invokeMethod(
+        this,
+        [this, localFileName, result]() {
+          if (result.canceled) {
+            emit canceled(localFileName);
+          } else if (!result.error.isEmpty()) {
+            emit error(localFileName, result.error);
+          } else {
+            if (result.mergedFaces >= 0) {
+              emit optimized(localFileName, result.nodes * kCubeVertices,
+                             result.nodes * kCubeTriangles,
+                             result.mergedFaces * 4, result.mergedFaces * 2);
+            }
+            emit exported(localFileName);
+          }
+          if (--m_pending == 0) emit busyChanged(false);
+        },
+        Qt::QueuedConnection);
+  });
+}
+
+void GLTFExport::cancel() { m_generation.ref(); }
+
+bool GLTFExport::writeNow(const QString &fileName, const QJsonObject &data,
+                          QString *error) {
+  m_jobFileName = fileName;
+  m_jobGeneration = m_generation.loadRelaxed();
+  m_jobReportsProgress = false;
+  Result result = exportModel(fileName, data, m_mode);
+  if (result.canceled) result.error = "Export canceled";
+  if (error) *error = result.error;
+  return result.error.isEmpty();
+}
+
+bool GLTFExport::writeNow(const QString &fileName, const PixelGrid &grid,
+                          QString *error) {
+  m_jobFileName = fileName;
+  m_jobGeneration = m_generation.loadRelaxed();
+  m_jobReportsProgress = false;
+  Result result = exportModel(fileName, grid, m_mode);
+  if (result.canceled) result.error = "Export canceled";
+  if (error) *error = result.error;
+  return result.error.isEmpty();
+}
+
+GLTFExport::Result GLTFExport::exportModel(const QString &localFileName,
+                                           QJsonObject data, Mode mode) {
+  Result result;
+  QString version = data.value("version").toString();
+  if (version != "1.0" && version != "1.1") {
+    result.error = "Invalid version number [1.0 or 1.1 != " + version + "]";
+    return result;
   }
-  int width = data.take("width").toInt();
-  int height = data.take("height").toInt();
-  if (width != height) {
-    emit error(localFileName, "invalid size");
-    return;
+  Model model;
+  model.width = data.value("width").toInt();
+  model.height = data.value("height").toInt();
+  if (model.width != model.height) {
+    result.error = "invalid size";
+    return result;
   }
 
-  QJsonArray pixelMap = data.take("pixels").toArray();
+  reportProgress(Collecting, 0, 1);
+  if (version == "1.0") {
+    // cells may have shapes of their own
+    QJsonArray pixelMap = data.take("pixels").toArray();
+    if (!buildUniqueVectors(pixelMap, model.width, model.height, model.shapes,
+                            model.colors, model.meshes, model.nodes)) {
+      result.error = "Pixels don't fit the grid size";
+      return result;
+    }
+  } else {
+    PixelGrid grid;
+    if (!grid.fromJson(data)) {
+      result.error = "Invalid project data";
+      return result;
+    }
+    buildUniqueVectors(grid, data.value("shape").toString("cube"),
+                       model.shapes, model.colors, model.meshes, model.nodes);
+  }
+  return writeModel(localFileName, model, mode);
+}
 
-  QVector<Node> nodes;
-  QVector<QString> shapes, colors;
-  QVector<QPair<int, int>> meshes;
+GLTFExport::Result GLTFExport::exportModel(const QString &localFileName,
+                                           const PixelGrid &grid, Mode mode) {
+  Model model;
+  model.width = grid.width();
+  model.height = grid.height();
+  if (model.width != model.height) {
+    Result result;
+    result.error = "invalid size";
+    return result;
+  }
 
-  buildUniqueVectors(pixelMap, shapes, colors, meshes, nodes);
+  reportProgress(Collecting, 0, 1);
+  // grids only have cubes, like the shape toCompactJson writes
+  buildUniqueVectors(grid, "cube", model.shapes, model.colors, model.meshes,
+                     model.nodes);
+  return writeModel(localFileName, model, mode);
+}
 
-  QJsonObject exportModel;
+GLTFExport::Result GLTFExport::writeModel(const QString &localFileName,
+                                          const Model &model, Mode mode) {
+  Result result;
+  const QVector<Node> &nodes = model.nodes;
+  const QVector<QPair<int, int>> &meshes = model.meshes;
+  int width = model.width;
+  int height = model.height;
+  if (nodes.isEmpty()) {
+    result.error = "Nothing to export";
+    return result;
+  }
+  result.nodes = nodes.size();
+  reportProgress(Collecting, 1, 1);
+  auto canceled = [&]() {
+    result.canceled = isCanceled();
+    return result.canceled;
+  };
+  if (canceled()) return result;
+
+  /* the document is streamed section by section into a QSaveFile, only
+   * the binary buffer and per-mesh data are kept in memory. the file only
+   * replaces an existing one once everything is written, a canceled export
+   * leaves it untouched
+   */
+  QSaveFile exportFile(localFileName);
+  if (!exportFile.open(QIODevice::WriteOnly)) {
+    result.error = "Can't write to file!";
+    return result;
+  }
+  bool binary = localFileName.endsWith(".glb", Qt::CaseInsensitive);
+  if (binary) beginGlb(&exportFile);
+
+  JsonStreamWriter writer(&exportFile);
+  GLTFBuffer buffer;
+
+  /* writing counts a step per node, the buffer as kBufferSteps and one
+   * more for committing the file
+   */
+  bool merged = mode == MergedMesh || mode == OptimizedMesh;
+  int nodeSteps = merged ? 0 : nodes.size();
+  m_jobWriteOffset = 0;
+  m_jobWriteTotal = nodeSteps + kBufferSteps + 1;
+
+  writer.beginObject();
+  insertInfo(writer);
+  if (merged) {
+    result.mergedFaces = insertMergedMesh(writer, nodes, meshes, width, height,
+                                          mode == OptimizedMesh, buffer);
+    if (canceled()) return result;
+  } else {
+    reportProgress(Meshing, 0, 1);
+    QVector<ShapeLibrary::Primitive> primitives;
+    if (!insertShapeData(model.shapes, buffer, primitives)) {
+      result.error = "Can't find or open shape files";
+      return result;
+    }
+    reportProgress(Meshing, 1, 1);
+    bool complete;
+    if (mode == InstancedMesh) {
+      insertScene(writer, meshes.size());
+      complete =
+          insertInstancedNodes(writer, nodes, meshes.size(), height, buffer);
+    } else {
+      insertScene(writer, nodes.size());
+      complete = insertNodes(writer, nodes, height);
+    }
+    if (!complete) {
+      result.canceled = true;
+      return result;
+    }
+    insertMeshes(writer, meshes, primitives);
+  }
 
-  insertInfo(exportModel);
-  insertScene(exportModel, nodes.size());
-  insertNodes(exportModel, nodes, height);
-  insertMeshes(exportModel, meshes);
-  insertMaterials(exportModel, colors);
-  if (!insertShapeData(exportModel, shapes)) {
-    emit error(localFileName, "Can't find or open shape files");
-    return;
+  m_jobWriteOffset = nodeSteps;
+  insertMaterials(writer, model.colors);
+  if (!insertBuffers(writer, buffer, binary)) {
+    result.canceled = true;
+    return result;
   }
+  writer.endObject();
 
-  if (!writeModel(exportModel, localFileName)) {
-    emit error(localFileName, "Can't write to file!");
-    return;
+  bool written = writer.flush();
+  if (written && binary) written = finishGlb(&exportFile, buffer.data());
+  // the last chance to cancel, a committed file counts as exported
+  if (canceled()) return result;
+  if (!written || !exportFile.commit()) {
+    result.error = "Can't write to file!";
+    return result;
   }
-  emit exported(localFileName);
+  reportProgress(Writing, m_jobWriteTotal, m_jobWriteTotal);
+  return result;
 }
 
-void GLTFExport::buildUniqueVectors(const QJsonArray &pixelMap,
-                                    QVector<QString> &shapes,
+bool GLTFExport::isCanceled() const {
+  return m_generation.loadRelaxed() != m_jobGeneration;
+}
+
+void GLTFExport::reportProgress(Stage stage, int done, int total) {
+  if (!m_jobReportsProgress) return;
+  // at most about a hundred updates per stage reach the gui thread
+  int step = qMax(1, total / 100);
+  if (stage == m_jobStage && done != total && done - m_jobDone < step) return;
+  m_jobStage = stage;
+  m_jobDone = done;
+  QString fileName = m_jobFileName;
+  QMetaObject::invokeMethod(
+      this,
+      [this, fileName, stage, done, total]() {
+        emit progress(fileName, stage, done, total);
+      },
+      Qt::QueuedConnection);
+}
+
+bool GLTFExport::writeProgress(int done) {
+  reportProgress(Writing, m_jobWriteOffset + done, m_jobWriteTotal);
+  return !isCanceled();
+}
+
+GLTFExport::Mode GLTFExport::mode() const { return m_mode; }
+
+bool GLTFExport::busy() const { return m_pending > 0; }
+
+void GLTFExport::setMode(Mode mode) {
+  if (m_mode == mode) return;
+
+  m_mode = mode;
+  emit modeChanged(mode);
+}
+
+bool GLTFExport::buildUniqueVectors(const QJsonArray &pixelMap, int width,
+                                    int height, QVector<QString> &shapes,
                                     QVector<QString> &colors,
                                     QVector<QPair<int, int>> &meshes,
                                     QVector<GLTFExport::Node> &nodes) {
   /* in this function we build unique sets of all used colors, shapes, ...
-   * so we can keep track of the indices in glTF format
+   * so we can keep track of the indices in glTF format. painted cells
+   * outside of width x height make it return false, the merged mesh
+   * indexes its planes by row and column
    */
   QMap<QString, int> uniqueShapes, uniqueColors;
   QMap<QPair<int, int>, int> uniqueMeshes;
@@ -72,6 +319,7 @@ void GLTFExport::buildUniqueVectors(const QJsonArray &pixelMap,
       QString color = itemColor.toString();
       QString shape = itemShape.toString();
       int depth = itemDepth.toInt();
+      if (i >= height || j >= width) return false;
 
       int shapeIdx;
       if (!uniqueShapes.contains(shape)) {
@@ -122,6 +370,37 @@ void GLTFExport::buildUniqueVectors(const QJsonArray &pixelMap,
        ++meshIter) {
     meshes[meshIter.value()] = meshIter.key();
   }
+  return true;
+}
+
+void GLTFExport::buildUniqueVectors(const PixelGrid &grid,
+                                    const QString &shape,
+                                    QVector<QString> &shapes,
+                                    QVector<QString> &colors,
+                                    QVector<QPair<int, int>> &meshes,
+                                    QVector<GLTFExport::Node> &nodes) {
+  /* all cells share one shape, so there is a mesh per used palette entry.
+   * colors and meshes are numbered in order of first use, like above
+   */
+  shapes = {shape};
+  QVector<int> meshOfColor(grid.palette().size(), -1);
+  for (int row = 0; row < grid.height(); ++row) {
+    for (int col = 0; col < grid.width(); ++col) {
+      int colorIdx = grid.colorIndex(row, col);
+      if (colorIdx < 0) continue;
+
+      int &meshIdx = meshOfColor[colorIdx];
+      if (meshIdx < 0) {
+        meshIdx = colors.size();
+        // with alpha, so translucent entries stay translucent
+        colors.append(grid.paletteColor(colorIdx).name(QColor::HexArgb));
+        meshes.append(QPair<int, int>(0, meshIdx));
+      }
+      Node node{.mesh = meshIdx, .depth = grid.depth(row, col), .row = row,
+                .col = col};
+      nodes.append(node);
+    }
+  }
 }
 
 QJsonArray GLTFExport::materialsFromColors(const QVector<QString> &colors,
@@ -137,117 +416,290 @@ QJsonArray GLTFExport::materialsFromColors(const QVector<QString> &colors,
                                             color.blueF(), color.alphaF()}},
              {"metallicFactor", metallicFactor},
              {"roughnessFactor", roughnessFactor}}}};
+    // glTF ignores the alpha of the base color unless asked to blend
+    if (color.alpha() < 255) material.insert("alphaMode", "BLEND");
     materials.append(material);
   }
   return materials;
 }
 
-void GLTFExport::insertInfo(QJsonObject &exportModel) {
-  exportModel.insert("asset", QJsonObject{{"generator", "Pixel Model Maker"},
+void GLTFExport::insertInfo(JsonStreamWriter &writer) {
+  writer.writeMember("asset", QJsonObject{{"generator", "Pixel Model Maker"},
                                           {"version", "2.0"}});
 }
 
-void GLTFExport::insertScene(QJsonObject &exportModel, int numNodes) {
+void GLTFExport::insertScene(JsonStreamWriter &writer, int numNodes) {
   /* we only have one scene and this scene have only one node
    * which is the last node in the node lists.
    * not that node list includes numNodes + 1 nodes
    */
-  exportModel.insert("scene", 0);
-  exportModel.insert("scenes",
+  writer.writeMember("scene", 0);
+  writer.writeMember("scenes",
                      QJsonArray{QJsonObject{{"nodes", QJsonArray{numNodes}}}});
 }
 
-void GLTFExport::insertNodes(QJsonObject &exportModel,
+bool GLTFExport::insertNodes(JsonStreamWriter &writer,
                              const QVector<GLTFExport::Node> &nodes,
                              int height) {
-  // insert all the nodes with ids related to other part of the gltf
-  QJsonArray nodesDef;
+  /* insert all the nodes with ids related to other part of the gltf
+   * there is one node per pixel, so they are formatted directly instead of
+   * going through a QJsonObject each. returns false if canceled meanwhile
+   */
+  writer.writeKey("nodes");
+  writer.beginArray();
   for (int i = 0; i < nodes.size(); ++i) {
-    QJsonObject nodeDef{{"mesh", nodes[i].mesh},
-                        {"translation", QJsonArray{nodes[i].row * 2 + 1,
-                                                   nodes[i].col * 2 + 1, 0}},
-                        {"scale", QJsonArray{1, 1, 2 * nodes[i].depth - 1}}};
-    nodesDef.append(nodeDef);
+    if (i % kNodeBatch == 0 && !writeProgress(i)) return false;
+    writer.writeRaw("{\"mesh\":" + QByteArray::number(nodes[i].mesh) +
+                    ",\"translation\":[" +
+                    QByteArray::number(nodes[i].row * 2 + 1) + "," +
+                    QByteArray::number(nodes[i].col * 2 + 1) +
+                    ",0],\"scale\":[1,1," +
+                    QByteArray::number(2 * nodes[i].depth - 1) + "]}");
   }
+  writeRootNode(writer, nodes.size(), height);
+  writer.endArray();
+  return writeProgress(nodes.size());
+}
+
+bool GLTFExport::insertInstancedNodes(JsonStreamWriter &writer,
+                                      const QVector<GLTFExport::Node> &nodes,
+                                      int numMeshes, int height,
+                                      GLTFBuffer &buffer) {
+  /* one node per mesh, every painted pixel of that mesh becomes an instance
+   * with the same translation and scale insertNodes would give its node.
+   * returns false if canceled meanwhile
+   */
+  QVector<QVector<float>> translations(numMeshes), scales(numMeshes);
+  for (int i = 0; i < nodes.size(); ++i) {
+    if (i % kNodeBatch == 0 && !writeProgress(i)) return false;
+    const Node &node = nodes[i];
+    translations[node.mesh] << node.row * 2 + 1 << node.col * 2 + 1 << 0;
+    scales[node.mesh] << 1 << 1 << 2 * node.depth - 1;
+  }
+
+  writer.writeKey("nodes");
+  writer.beginArray();
+  for (int i = 0; i < numMeshes; ++i) {
+    int translation = buffer.addVec3Accessor(translations[i],
+                                             GLTFBuffer::NoTarget, false);
+    int scale = buffer.addVec3Accessor(scales[i], GLTFBuffer::NoTarget, false);
+    writer.writeValue(QJsonObject{
+        {"mesh", i},
+        {"extensions",
+         QJsonObject{{kInstancingExtension,
+                      QJsonObject{{"attributes",
+                                   QJsonObject{{"TRANSLATION", translation},
+                                               {"SCALE", scale}}}}}}}});
+  }
+  writeRootNode(writer, numMeshes, height);
+  writer.endArray();
 
+  /* without the extension a viewer would draw a single instance per mesh,
+   * so it is marked as required
+   */
+  writer.writeMember("extensionsUsed", QJsonArray{kInstancingExtension});
+  writer.writeMember("extensionsRequired", QJsonArray{kInstancingExtension});
+  return writeProgress(nodes.size());
+}
+
+void GLTFExport::writeRootNode(JsonStreamWriter &writer, int numChildren,
+                               int height) {
   /*
    * insert one additional node for final adjustments like translation and
    * rotations all other nodes added to the children of this node, and this node
    * is the only node in the scene
    */
-
-  QJsonArray scenesNodes;
-  for (int i = 0; i < nodes.size(); ++i) scenesNodes.append(i);
-  nodesDef.append(QJsonObject{
-      {"children", scenesNodes},
-      {"translation", QJsonArray{0, 2 * height, 0}},
-      {"rotation", QJsonArray{0, 0, -0.7071068286895752, 0.7071068286895752}}});
-  exportModel.insert("nodes", nodesDef);
+  writer.beginObject();
+  writer.writeKey("children");
+  writer.beginArray();
+  for (int i = 0; i < numChildren; ++i) writer.writeInt(i);
+  writer.endArray();
+  writer.writeMember("translation", QJsonArray{0, 2 * height, 0});
+  writer.writeMember(
+      "rotation", QJsonArray{0, 0, -0.7071068286895752, 0.7071068286895752});
+  writer.endObject();
 }
 
-void GLTFExport::insertMeshes(QJsonObject &exportModel,
-                              const QVector<QPair<int, int>> meshes) {
-  /* INFO: the only assumption is that every shape should have exactly
-   *       1 buffer, 3 bufferviews and 3 accessors
-   */
-
-  /* WARNING: for now its only working with one shape wich is cube
-   *       when you want to add other shapes you must remember to adjust
-   *       bufer indices inside bufferviews and buferview indices inside
-   *       accessors
+void GLTFExport::insertMeshes(
+    JsonStreamWriter &writer, const QVector<QPair<int, int>> meshes,
+    const QVector<ShapeLibrary::Primitive> &primitives) {
+  /* INFO: the only assumption is that every shape has one mesh with one
+   *       primitive, its accessors are already rebased by insertShapeData
    */
   QJsonArray meshesDef;
   for (int i = 0; i < meshes.size(); ++i) {
+    const ShapeLibrary::Primitive &primitive = primitives[meshes[i].first];
     QJsonObject meshDef{
         {"primitives",
          QJsonArray{QJsonObject{
-             {"attributes", QJsonObject{{"POSITION", meshes[i].first * 3},
-                                        {"NORMAL", meshes[i].first * 3 + 1}}},
-             {"indices", meshes[i].first * 3 + 2},
+             {"attributes", QJsonObject{{"POSITION", primitive.position},
+                                        {"NORMAL", primitive.normal}}},
+             {"indices", primitive.indices},
              {"material", meshes[i].second}}}}};
     meshesDef.append(meshDef);
   }
-  exportModel.insert("meshes", meshesDef);
+  writer.writeMember("meshes", meshesDef);
 }
 
-void GLTFExport::insertMaterials(QJsonObject &exportModel,
+int GLTFExport::insertMergedMesh(JsonStreamWriter &writer,
+                                 const QVector<GLTFExport::Node> &nodes,
+                                 const QVector<QPair<int, int>> &meshes,
+                                 int width, int height, bool greedy,
+                                 GLTFBuffer &buffer) {
+  /* all cells are merged into a single mesh with one primitive per material,
+   * faces hidden by a neighbour are dropped and the root node rotation and
+   * translation of insertNodes are baked into the vertices, which the mesher
+   * already produces in that orientation. this mode assumes cube shapes.
+   * with greedy set, coplanar faces are merged into maximal rectangles.
+   * returns the number of written faces (quads), or -1 if the export was
+   * canceled while meshing.
+   */
+  QVector<int> materials(width * height, -1);
+  QVector<int> depths(width * height, 0);
+  int numMaterials = 0;
+  for (const Node &node : nodes) {
+    int material = meshes[node.mesh].second;
+    materials[node.row * width + node.col] = material;
+    depths[node.row * width + node.col] = node.depth;
+    numMaterials = qMax(numMaterials, material + 1);
+  }
+
+  reportProgress(Meshing, 0, 1);
+  // the cube spans [-(2 * depth - 1), 2 * depth - 1] along z
+  VoxelMesher mesher(width, height, materials, depths);
+  mesher.setDepthExtent(1.0f, -0.5f);
+  QVector<VoxelMesher::Face> allFaces =
+      greedy ? mesher.greedyFaces() : mesher.faces();
+  if (isCanceled()) return -1;
+  reportProgress(Meshing, 1, 1);
+
+  QVector<QVector<VoxelMesher::Face>> facesByMaterial(numMaterials);
+  for (const VoxelMesher::Face &face : allFaces) {
+    facesByMaterial[face.material].append(face);
+  }
+
+  QJsonArray primitives;
+  for (int material = 0; material < numMaterials; ++material) {
+    const QVector<VoxelMesher::Face> &faces = facesByMaterial[material];
+    if (faces.isEmpty()) continue;
+
+    QVector<float> positions, normals;
+    QVector<quint32> indices;
+    positions.reserve(faces.size() * 12);
+    normals.reserve(faces.size() * 12);
+    indices.reserve(faces.size() * 6);
+    for (const VoxelMesher::Face &face : faces) {
+      quint32 base = positions.size() / 3;
+      const QVector3D corners[4] = {face.origin, face.origin + face.u,
+                                    face.origin + face.u + face.v,
+                                    face.origin + face.v};
+      for (const QVector3D &corner : corners) {
+        positions << corner.x() * kCellSize << corner.y() * kCellSize
+                  << corner.z() * kCellSize;
+        normals << face.normal.x() << face.normal.y() << face.normal.z();
+      }
+      indices << base << base + 1 << base + 2 << base << base + 2 << base + 3;
+    }
+
+    int vertexCount = positions.size() / 3;
+    int position =
+        buffer.addVec3Accessor(positions, GLTFBuffer::ArrayBuffer, true);
+    int normal =
+        buffer.addVec3Accessor(normals, GLTFBuffer::ArrayBuffer, false);
+    int index = buffer.addIndexAccessor(indices, vertexCount);
+    primitives.append(QJsonObject{
+        {"attributes", QJsonObject{{"POSITION", position}, {"NORMAL", normal}}},
+        {"indices", index},
+        {"material", material}});
+  }
+
+  writer.writeMember("scene", 0);
+  writer.writeMember("scenes",
+                     QJsonArray{QJsonObject{{"nodes", QJsonArray{0}}}});
+  writer.writeMember("nodes", QJsonArray{QJsonObject{{"mesh", 0}}});
+  writer.writeMember("meshes",
+                     QJsonArray{QJsonObject{{"primitives", primitives}}});
+  return allFaces.size();
+}
+
+void GLTFExport::insertMaterials(JsonStreamWriter &writer,
                                  const QVector<QString> &colors) {
   QJsonArray materials = materialsFromColors(colors);
-  exportModel.insert("materials", materials);
+  writer.writeMember("materials", materials);
 }
 
-bool GLTFExport::insertShapeData(QJsonObject &exportModel,
-                                 const QVector<QString> &shapes) {
-  /* Note: in this function we should merge all the shape infos and
-   * adjust all the refrences in accessors and buffer views
-   * for now it only support one shape so we only use shape[0]
+bool GLTFExport::insertShapeData(const QVector<QString> &shapes,
+                                 GLTFBuffer &buffer,
+                                 QVector<ShapeLibrary::Primitive> &primitives) {
+  /* the shape library merges the geometry of every used shape into the
+   * export buffer and rebases their bufferViews and accessors. the decoded
+   * data is appended to the export buffer, insertBuffers decides whether it
+   * goes back into a data uri (.gltf) or into a BIN chunk (.glb)
    */
-  QFile shapeFile(":/ui/exports/" + shapes[0] + ".gltf");
-  if (!shapeFile.exists()) {
-    return false;
-  }
-  if (!shapeFile.open(QIODevice::ReadOnly)) {
-    return false;
+  return ShapeLibrary::instance().appendShapes(shapes, buffer, primitives);
+}
+
+bool GLTFExport::insertBuffers(JsonStreamWriter &writer,
+                               const GLTFBuffer &buffer, bool binary) {
+  /* bufferViews and accessors are complete once every other section has
+   * been written, so they go last together with the buffer itself. for .glb
+   * the data follows in the BIN chunk, for .gltf it is streamed as base64
+   * in blocks that are a multiple of 3 bytes so they concatenate cleanly.
+   * returns false if canceled between two blocks
+   */
+  const QByteArray &binData = buffer.data();
+  writer.writeMember("bufferViews", buffer.bufferViews());
+  writer.writeMember("accessors", buffer.accessors());
+  writer.writeKey("buffers");
+  writer.beginArray();
+  writer.beginObject();
+  writer.writeMember("byteLength", binData.size());
+  if (!binary) {
+    writer.writeKey("uri");
+    writer.writeRaw(QByteArray("\"") + GLTFBuffer::kDataUriPrefix);
+    const int blockSize = 3 * 16 * 1024;
+    for (int offset = 0; offset < binData.size(); offset += blockSize) {
+      int done = int(qint64(offset) * kBufferSteps / binData.size());
+      if (!writeProgress(done)) return false;
+      writer.appendRaw(binData.mid(offset, blockSize).toBase64());
+    }
+    writer.appendRaw("\"");
   }
+  writer.endObject();
+  writer.endArray();
+  return writeProgress(kBufferSteps);
+}
 
-  QJsonObject shapeDef = QJsonDocument::fromJson(shapeFile.readAll()).object();
-  exportModel.insert("buffers", shapeDef.take("buffers"));
-  exportModel.insert("bufferViews", shapeDef.take("bufferViews"));
-  exportModel.insert("accessors", shapeDef.take("accessors"));
-  shapeFile.close();
-  return true;
+void GLTFExport::beginGlb(QIODevice *device) {
+  // header and JSON chunk header are patched by finishGlb
+  device->write(QByteArray(20, '\0'));
 }
 
-bool GLTFExport::writeModel(const QJsonObject &exportModel,
-                            const QString &fileName) {
-  QJsonDocument doc(exportModel);
-  QByteArray exportData = doc.toJson();
-  QFile exportFile(fileName);
-  if (exportFile.open(QIODevice::WriteOnly)) {
-    exportFile.write(exportData);
-  } else {
-    return false;
+bool GLTFExport::finishGlb(QIODevice *device, const QByteArray &binData) {
+  /* glb layout: 12 byte header, then a JSON chunk padded with spaces and a
+   * BIN chunk padded with zeros, both chunks aligned to 4 bytes
+   */
+  qint64 jsonLength = device->pos() - 20;
+  while (jsonLength % 4) {
+    device->write(" ", 1);
+    ++jsonLength;
   }
-  exportFile.close();
-  return true;
+
+  QByteArray binChunk;
+  int binLength = (binData.size() + 3) / 4 * 4;
+  appendUInt32(binChunk, binLength);
+  appendUInt32(binChunk, kGlbChunkBin);
+  binChunk.append(binData);
+  binChunk.append(QByteArray(binLength - binData.size(), '\0'));
+  if (device->write(binChunk) != binChunk.size()) return false;
+
+  QByteArray header;
+  appendUInt32(header, kGlbMagic);
+  appendUInt32(header, kGlbVersion);
+  appendUInt32(header, quint32(device->pos()));
+  appendUInt32(header, quint32(jsonLength));
+  appendUInt32(header, kGlbChunkJson);
+  qint64 end = device->pos();
+  if (!device->seek(0) || device->write(header) != header.size()) return false;
+  return device->seek(end);
 }
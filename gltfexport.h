@@ -3,19 +3,69 @@
 
 #include <QtCore>
 
+#include "shapelibrary.h"
+
+class GLTFBuffer;
+class JsonStreamWriter;
+class PixelGrid;
+
 class GLTFExport : public QObject {
   Q_OBJECT
   Q_DISABLE_COPY(GLTFExport)
+  Q_PROPERTY(Mode mode READ mode WRITE setMode NOTIFY modeChanged)
+  Q_PROPERTY(bool busy READ busy NOTIFY busyChanged)
 
  public:
+  enum Mode {
+    NodePerPixel,  // one node per painted pixel, all sharing the shape mesh
+    MergedMesh,    // one primitive per material with hidden faces removed
+    OptimizedMesh,  // like MergedMesh, with coplanar faces greedily merged
+    InstancedMesh,  // one node per mesh using EXT_mesh_gpu_instancing
+  };
+  Q_ENUM(Mode)
+
+  enum Stage {
+    Collecting,  // gathering the painted cells, colors and shapes
+    Meshing,     // building the meshes or loading the shapes
+    Writing,     // streaming the document into the file
+  };
+  Q_ENUM(Stage)
+
   GLTFExport(QObject *parent = 0);
   ~GLTFExport();
 
+  /* exports data to fileName on a worker thread, in the mode set at the
+   * time of the call. exports run one at a time in the order requested and
+   * report through progress and then exported, error or canceled
+   */
   Q_INVOKABLE void write(QUrl fileName, QJsonObject data);
+  // stops the running export and drops the queued ones
+  Q_INVOKABLE void cancel();
+  /* exports on the calling thread without emitting any signal. different
+   * objects can do this on different threads at the same time, but not
+   * while the same object runs an export started by write
+   */
+  bool writeNow(const QString &fileName, const QJsonObject &data,
+                QString *error = nullptr);
+  // same, straight from a grid without going through its JSON form
+  bool writeNow(const QString &fileName, const PixelGrid &grid,
+                QString *error = nullptr);
+
+  Mode mode() const;
+  bool busy() const;
+
+ public slots:
+  void setMode(Mode mode);
 
  signals:
   void exported(QString fileName);
   void error(QString fileName, QString error);
+  void optimized(QString fileName, int verticesBefore, int trianglesBefore,
+                 int verticesAfter, int trianglesAfter);
+  void modeChanged(Mode mode);
+  void progress(QString fileName, Stage stage, int done, int total);
+  void canceled(QString fileName);
+  void busyChanged(bool busy);
 
  private:
   struct Node {
@@ -25,24 +75,83 @@ class GLTFExport : public QObject {
     int col;
   };
 
-  void buildUniqueVectors(const QJsonArray &pixelMap, QVector<QString> &shapes,
-                          QVector<QString> &colors,
+  struct Result {
+    QString error;
+    int nodes = 0;
+    int mergedFaces = -1;  // only set for merged meshes
+    bool canceled = false;  // decided before the file was committed
+  };
+
+  // what the cells of a project turn into, see buildUniqueVectors
+  struct Model {
+    QVector<QString> shapes;
+    QVector<QString> colors;
+    QVector<QPair<int, int>> meshes;
+    QVector<Node> nodes;
+    int width = 0;
+    int height = 0;
+  };
+
+  // the export pipeline, runs on the worker thread
+  Result exportModel(const QString &localFileName, QJsonObject data,
+                     Mode mode);
+  Result exportModel(const QString &localFileName, const PixelGrid &grid,
+                     Mode mode);
+  Result writeModel(const QString &localFileName, const Model &model,
+                    Mode mode);
+  bool isCanceled() const;
+  void reportProgress(Stage stage, int done, int total);
+  // reports done steps of the Writing stage, false once canceled
+  bool writeProgress(int done);
+
+  bool buildUniqueVectors(const QJsonArray &pixelMap, int width, int height,
+                          QVector<QString> &shapes, QVector<QString> &colors,
+                          QVector<QPair<int, int>> &meshes,
+                          QVector<Node> &nodes);
+  void buildUniqueVectors(const PixelGrid &grid, const QString &shape,
+                          QVector<QString> &shapes, QVector<QString> &colors,
                           QVector<QPair<int, int>> &meshes,
                           QVector<Node> &nodes);
   QJsonArray materialsFromColors(const QVector<QString> &colors,
                                  float metallicFactor = 0.0f,
                                  float roughnessFactor = 1.0f);
-  void insertInfo(QJsonObject &exportModel);
-  void insertScene(QJsonObject &exportModel, int numNodes);
-  void insertNodes(QJsonObject &exportModel,
+  void insertInfo(JsonStreamWriter &writer);
+  void insertScene(JsonStreamWriter &writer, int numNodes);
+  bool insertNodes(JsonStreamWriter &writer,
                    const QVector<GLTFExport::Node> &nodes, int height);
-  void insertMeshes(QJsonObject &exportModel,
-                    const QVector<QPair<int, int>> meshes);
-  void insertMaterials(QJsonObject &exportModel,
+  bool insertInstancedNodes(JsonStreamWriter &writer,
+                            const QVector<GLTFExport::Node> &nodes,
+                            int numMeshes, int height, GLTFBuffer &buffer);
+  void writeRootNode(JsonStreamWriter &writer, int numChildren, int height);
+  void insertMeshes(JsonStreamWriter &writer,
+                    const QVector<QPair<int, int>> meshes,
+                    const QVector<ShapeLibrary::Primitive> &primitives);
+  void insertMaterials(JsonStreamWriter &writer,
                        const QVector<QString> &colors);
-  bool insertShapeData(QJsonObject &exportModel,
-                       const QVector<QString> &shapes);
-  bool writeModel(const QJsonObject &exportModel, const QString &fileName);
+  int insertMergedMesh(JsonStreamWriter &writer,
+                       const QVector<GLTFExport::Node> &nodes,
+                       const QVector<QPair<int, int>> &meshes, int width,
+                       int height, bool greedy, GLTFBuffer &buffer);
+  bool insertShapeData(const QVector<QString> &shapes, GLTFBuffer &buffer,
+                       QVector<ShapeLibrary::Primitive> &primitives);
+  bool insertBuffers(JsonStreamWriter &writer, const GLTFBuffer &buffer,
+                     bool binary);
+  void beginGlb(QIODevice *device);
+  bool finishGlb(QIODevice *device, const QByteArray &binData);
+
+  Mode m_mode = NodePerPixel;
+  int m_pending = 0;  // requested exports that haven't reported yet
+  QThreadPool m_pool;
+  QAtomicInt m_generation;  // bumped by cancel
+  // state of the running export, only touched by the worker
+  int m_jobGeneration = 0;
+  QString m_jobFileName;
+  bool m_jobReportsProgress = false;
+  int m_jobStage = -1;  // stage and step of the last progress report
+  int m_jobDone = 0;
+  // the Writing stage counts nodes, then base64 blocks as steps
+  int m_jobWriteOffset = 0;
+  int m_jobWriteTotal = 0;
 };
 
 #endif  // GLTFEXPORT_H
@@ -0,0 +1,200 @@
+#include "headlessexport.h"
+
+#include "gltfexport.h"
+#include "pixelgrid.h"
+#include "projectformat.h"
+#include "workstealingpool.h"
+
+namespace {
+enum ExitCode { Success = 0, ExportFailed = 1, UsageError = 2 };
+
+const QStringList kProjectPatterns = {"*.json", "*.pmm"};
+
+// reads input and exports it with its own exporter, safe on any thread
+bool exportProject(const QString &input, const QString &output,
+                   GLTFExport::Mode mode, QString *error) {
+  PixelGrid grid;
+  QString message;
+  if (!ProjectFormat::read(input, grid, &message)) {
+    *error = "Can't read " + input + ": " + message;
+    return false;
+  }
+  GLTFExport exporter;
+  exporter.setMode(mode);
+  if (!exporter.writeNow(output, grid, &message)) {
+    *error = "Can't export " + output + ": " + message;
+    return false;
+  }
+  return true;
+}
+
+/* directories stand for the projects in them, other arguments may be
+ * globs. directories and globs without any project end up in unmatched
+ */
+QStringList expandInputs(const QStringList &arguments,
+                         QStringList *unmatched) {
+  QStringList files;
+  for (const QString &argument : arguments) {
+    QFileInfo info(argument);
+    QDir dir;
+    QStringList names;
+    if (info.isDir()) {
+      dir.setPath(argument);
+      names = dir.entryList(kProjectPatterns, QDir::Files, QDir::Name);
+    } else if (info.fileName().contains(QRegularExpression("[*?[]"))) {
+      dir = info.dir();
+      names = dir.entryList({info.fileName()}, QDir::Files, QDir::Name);
+    } else {
+      files.append(argument);
+      continue;
+    }
+    if (names.isEmpty()) unmatched->append(argument);
+    for (const QString &name : names) files.append(dir.filePath(name));
+  }
+  return files;
+}
+
+int runBatch(const QStringList &inputs, const QString &outputDir,
+             GLTFExport::Mode mode, const QString &suffix) {
+  struct Conversion {
+    QString input;
+    QString output;
+    QString error;
+    qint64 msecs = 0;
+  };
+
+  QVector<Conversion> conversions;
+  QStringList unmatched;
+  QSet<QString> outputs;
+  for (const QString &input : expandInputs(inputs, &unmatched)) {
+    Conversion conversion;
+    conversion.input = input;
+    conversion.output = QDir(outputDir).filePath(
+        QFileInfo(input).completeBaseName() + "." + suffix);
+    if (outputs.contains(conversion.output))
+      conversion.error = "Another project is exported to " + conversion.output;
+    outputs.insert(conversion.output);
+    conversions.append(conversion);
+  }
+  if (conversions.isEmpty()) {
+    QTextStream(stderr) << "No projects found in " << inputs.join(", ")
+                        << "\n";
+    return ExportFailed;
+  }
+  // reported as failures, so a typo in a glob doesn't pass unnoticed
+  for (const QString &input : unmatched) {
+    Conversion conversion;
+    conversion.input = input;
+    conversion.error = "No projects found";
+    conversions.append(conversion);
+  }
+  if (!QDir().mkpath(outputDir)) {
+    QTextStream(stderr) << "Can't create " << outputDir << "\n";
+    return ExportFailed;
+  }
+
+  // every task only touches its own element, so the vector must not detach
+  Conversion *results = conversions.data();
+  WorkStealingPool pool;
+  for (int i = 0; i < conversions.size(); ++i) {
+    if (!results[i].error.isEmpty()) continue;
+    pool.add([results, i, mode]() {
+      Conversion &conversion = results[i];
+      QElapsedTimer timer;
+      timer.start();
+      exportProject(conversion.input, conversion.output, mode,
+                    &conversion.error);
+      conversion.msecs = timer.elapsed();
+    });
+  }
+  QElapsedTimer wallTime;
+  wallTime.start();
+  pool.run();
+  qint64 elapsed = wallTime.elapsed();
+
+  QTextStream out(stdout);
+  int failed = 0;
+  qint64 busy = 0;
+  for (const Conversion &conversion : conversions) {
+    busy += conversion.msecs;
+    if (conversion.error.isEmpty()) {
+      out << "ok     " << qSetFieldWidth(6) << conversion.msecs
+          << qSetFieldWidth(0) << " ms  " << conversion.input << "\n";
+    } else {
+      ++failed;
+      out << "failed " << qSetFieldWidth(6) << conversion.msecs
+          << qSetFieldWidth(0) << " ms  " << conversion.input << ": "
+          << conversion.error << "\n";
+    }
+  }
+  out << conversions.size() - failed << " exported, " << failed
+      << " failed in " << elapsed << " ms (" << busy << " ms of work on "
+      << pool.threadCount() << " threads)\n";
+  return failed ? ExportFailed : Success;
+}
+}  // namespace
+
+bool HeadlessExport::isRequested(int argc, char *argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    QByteArray argument(argv[i]);
+    // the values may also be attached, as in --batch=out/
+    for (const char *option : {"--export", "--batch"}) {
+      if (argument == option || argument.startsWith(QByteArray(option) + '='))
+        return true;
+    }
+  }
+  return false;
+}
+
+int HeadlessExport::run(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Exports Pixel Model Maker projects.");
+  parser.addHelpOption();
+  QCommandLineOption exportOption(
+      "export", "Export the project <in> to the glTF file <out>.", "in");
+  QCommandLineOption batchOption(
+      "batch",
+      "Export all given projects, directories and globs into <dir>, using "
+      "every core.",
+      "dir");
+  QCommandLineOption binaryOption("binary", "Write .glb files in batches.");
+  QCommandLineOption modeOption("mode", "Export mode, a GLTFExport::Mode.",
+                                "mode", "NodePerPixel");
+  parser.addOptions({exportOption, batchOption, binaryOption, modeOption});
+  parser.addPositionalArgument(
+      "files", "<out> for --export, the projects for --batch.");
+  parser.process(app);
+
+  QTextStream err(stderr);
+  bool batch = parser.isSet(batchOption);
+  QStringList positional = parser.positionalArguments();
+  if (batch == parser.isSet(exportOption) || positional.isEmpty() ||
+      (!batch && positional.size() != 1)) {
+    err << parser.helpText();
+    return UsageError;
+  }
+
+  bool validMode;
+  int mode = QMetaEnum::fromType<GLTFExport::Mode>().keyToValue(
+      parser.value(modeOption).toLatin1(), &validMode);
+  if (!validMode) {
+    err << "Unknown export mode " << parser.value(modeOption) << "\n";
+    return UsageError;
+  }
+
+  if (batch) {
+    return runBatch(positional, parser.value(batchOption),
+                    GLTFExport::Mode(mode),
+                    parser.isSet(binaryOption) ? "glb" : "gltf");
+  }
+
+  QString message;
+  if (!exportProject(parser.value(exportOption), positional.first(),
+                     GLTFExport::Mode(mode), &message)) {
+    err << message << "\n";
+    return ExportFailed;
+  }
+  return Success;
+}
@@ -0,0 +1,25 @@
+#ifndef HEADLESSEXPORT_H
+#define HEADLESSEXPORT_H
+
+#include <QtCore>
+
+/* HeadlessExport converts projects to glTF from the command line, without
+ * a window, QML or fonts:
+ *
+ *   PixelModelMaker --export in.json out.gltf [--mode OptimizedMesh]
+ *   PixelModelMaker --batch out/ [--binary] [--mode ...] sprites/ "*.pmm"
+ *
+ * The input may be any project ProjectFormat reads, the output suffix
+ * picks .gltf or .glb and the mode is a GLTFExport::Mode name. Batches
+ * are spread over all cores with a WorkStealingPool and end with the time
+ * and error of every file.
+ */
+class HeadlessExport {
+ public:
+  // whether the arguments ask for a headless run instead of the editor
+  static bool isRequested(int argc, char *argv[]);
+  // returns the process exit code, non-zero on failure
+  static int run(int argc, char *argv[]);
+};
+
+#endif  // HEADLESSEXPORT_H
@@ -0,0 +1,106 @@
+#include "jsonstreamwriter.h"
+
+namespace {
+const int kFlushSize = 64 * 1024;
+}
+
+JsonStreamWriter::JsonStreamWriter(QIODevice *device) : m_device(device) {
+  m_buffer.reserve(kFlushSize + 1024);
+}
+
+JsonStreamWriter::~JsonStreamWriter() { flush(); }
+
+void JsonStreamWriter::beginObject() {
+  separate();
+  write('{');
+  m_first.append(true);
+}
+
+void JsonStreamWriter::endObject() {
+  m_first.removeLast();
+  write('}');
+}
+
+void JsonStreamWriter::beginArray() {
+  separate();
+  write('[');
+  m_first.append(true);
+}
+
+void JsonStreamWriter::endArray() {
+  m_first.removeLast();
+  write(']');
+}
+
+void JsonStreamWriter::writeKey(const QString &key) {
+  writeValue(key);
+  write(':');
+  m_afterKey = true;
+}
+
+void JsonStreamWriter::writeValue(const QJsonValue &value) {
+  separate();
+  if (value.isObject()) {
+    write(QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact));
+  } else if (value.isArray()) {
+    write(QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact));
+  } else {
+    // let QJsonDocument handle escaping and number formatting of scalars
+    QByteArray json =
+        QJsonDocument(QJsonArray{value}).toJson(QJsonDocument::Compact);
+    write(json.mid(1, json.size() - 2));
+  }
+}
+
+void JsonStreamWriter::writeInt(qint64 value) {
+  separate();
+  write(QByteArray::number(value));
+}
+
+void JsonStreamWriter::writeMember(const QString &key,
+                                   const QJsonValue &value) {
+  writeKey(key);
+  writeValue(value);
+}
+
+void JsonStreamWriter::writeRaw(const QByteArray &json) {
+  separate();
+  write(json);
+}
+
+void JsonStreamWriter::appendRaw(const QByteArray &json) { write(json); }
+
+bool JsonStreamWriter::flush() {
+  if (!m_buffer.isEmpty() && !m_error) {
+    if (m_device->write(m_buffer) != m_buffer.size()) m_error = true;
+  }
+  m_buffer.clear();
+  return !m_error;
+}
+
+bool JsonStreamWriter::hasError() const { return m_error; }
+
+void JsonStreamWriter::separate() {
+  // a value right after its key, or the first item of a container, has no
+  // leading comma
+  if (m_afterKey) {
+    m_afterKey = false;
+    return;
+  }
+  if (m_first.isEmpty()) return;
+  if (m_first.last()) {
+    m_first.last() = false;
+  } else {
+    write(',');
+  }
+}
+
+void JsonStreamWriter::write(const QByteArray &data) {
+  m_buffer.append(data);
+  if (m_buffer.size() >= kFlushSize) flush();
+}
+
+void JsonStreamWriter::write(char c) {
+  m_buffer.append(c);
+  if (m_buffer.size() >= kFlushSize) flush();
+}
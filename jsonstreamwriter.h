@@ -0,0 +1,49 @@
+#ifndef JSONSTREAMWRITER_H
+#define JSONSTREAMWRITER_H
+
+#include <QtCore>
+
+/* JsonStreamWriter writes compact JSON straight into a QIODevice, token by
+ * token, so large documents never exist as a QJsonObject tree or as one big
+ * QByteArray. Small sub trees can still be written as QJsonValue.
+ *
+ * Output is staged in a small buffer which is flushed to the device
+ * whenever it grows past kFlushSize and at flush().
+ */
+class JsonStreamWriter {
+ public:
+  explicit JsonStreamWriter(QIODevice *device);
+  ~JsonStreamWriter();
+
+  void beginObject();
+  void endObject();
+  void beginArray();
+  void endArray();
+
+  void writeKey(const QString &key);
+  void writeValue(const QJsonValue &value);
+  void writeInt(qint64 value);
+  void writeMember(const QString &key, const QJsonValue &value);
+
+  /* writes an already encoded JSON token, appendRaw continues the last one
+   * without a separator, e.g. to stream a long string in pieces
+   */
+  void writeRaw(const QByteArray &json);
+  void appendRaw(const QByteArray &json);
+
+  bool flush();
+  bool hasError() const;
+
+ private:
+  void separate();
+  void write(const QByteArray &data);
+  void write(char c);
+
+  QIODevice *m_device;
+  QByteArray m_buffer;
+  QVector<bool> m_first;  // one entry per open object or array
+  bool m_afterKey = false;
+  bool m_error = false;
+};
+
+#endif  // JSONSTREAMWRITER_H
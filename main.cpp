@@ -1,20 +1,44 @@
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QtQuick>
+#include "autosavejournal.h"
+#include "depthview.h"
 #include "fileio.h"
 #include "gltfexport.h"
+#include "headlessexport.h"
+#include "pixelcanvas.h"
+#include "pixelgrid.h"
+#include "strokeengine.h"
+#include "undohistory.h"
+#include "voxelgeometry.h"
+#include "voxelinstancing.h"
 
 int main(int argc, char *argv[])
 {
+    // command line conversions don't need a window, QML or fonts
+    if (HeadlessExport::isRequested(argc, argv))
+        return HeadlessExport::run(argc, argv);
+
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
     QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
 #endif
 
     QGuiApplication app(argc, argv);
+    // locates the settings and the journals of unsaved grids
+    app.setOrganizationName("zaghaghi");
+    app.setApplicationName("PixelModelMaker");
 
 
+    qmlRegisterType<AutosaveJournal>("com.github.zaghaghi.pixelmodelmaker", 1, 0, "AutosaveJournal");
     qmlRegisterType<FileIO>("com.github.zaghaghi.pixelmodelmaker", 1, 0, "FileIO");
     qmlRegisterType<GLTFExport>("com.github.zaghaghi.pixelmodelmaker", 1, 0, "GltfExport");
+    qmlRegisterType<PixelGrid>("com.github.zaghaghi.pixelmodelmaker", 1, 0, "PixelGrid");
+    qmlRegisterType<PixelCanvas>("com.github.zaghaghi.pixelmodelmaker", 1, 0, "PixelCanvas");
+    qmlRegisterType<StrokeEngine>("com.github.zaghaghi.pixelmodelmaker", 1, 0, "StrokeEngine");
+    qmlRegisterType<UndoHistory>("com.github.zaghaghi.pixelmodelmaker", 1, 0, "UndoHistory");
+    qmlRegisterType<DepthView>("com.github.zaghaghi.pixelmodelmaker", 1, 0, "DepthView");
+    qmlRegisterType<VoxelGeometry>("com.github.zaghaghi.pixelmodelmaker", 1, 0, "VoxelGeometry");
+    qmlRegisterType<VoxelInstancing>("com.github.zaghaghi.pixelmodelmaker", 1, 0, "VoxelInstancing");
     QQuickView view;
     view.setTitle("Pixel Model Maker");
     view.engine()->addImportPath("qrc:/ui/imports");
@@ -0,0 +1,142 @@
+#include "pixelcanvas.h"
+
+#include <QQuickWindow>
+#include <QSGSimpleTextureNode>
+
+PixelCanvas::PixelCanvas(QQuickItem *parent) : QQuickItem(parent) {
+  setFlag(ItemHasContents, true);
+}
+
+PixelCanvas::~PixelCanvas() {}
+
+PixelGrid *PixelCanvas::grid() const { return m_grid; }
+
+QColor PixelCanvas::checkerColor() const { return m_checkerColor; }
+
+QColor PixelCanvas::alternateCheckerColor() const {
+  return m_alternateCheckerColor;
+}
+
+void PixelCanvas::setGrid(PixelGrid *grid) {
+  if (m_grid == grid) return;
+
+  if (m_grid) disconnect(m_grid, nullptr, this, nullptr);
+  m_grid = grid;
+  if (m_grid) {
+    connect(m_grid, &PixelGrid::cellsChanged, this, &PixelCanvas::updateCells);
+    connect(m_grid, &PixelGrid::gridChanged, this, &PixelCanvas::resetCells);
+    connect(m_grid, &PixelGrid::paletteChanged, this,
+            &PixelCanvas::resetCells);
+  }
+  resetCells();
+  emit gridChanged(grid);
+}
+
+void PixelCanvas::setCheckerColor(QColor color) {
+  if (m_checkerColor == color) return;
+
+  m_checkerColor = color;
+  m_checkerDirty = true;
+  update();
+  emit checkerChanged();
+}
+
+void PixelCanvas::setAlternateCheckerColor(QColor color) {
+  if (m_alternateCheckerColor == color) return;
+
+  m_alternateCheckerColor = color;
+  m_checkerDirty = true;
+  update();
+  emit checkerChanged();
+}
+
+QSGNode *PixelCanvas::updatePaintNode(QSGNode *oldNode,
+                                      UpdatePaintNodeData *) {
+  // the gui thread is blocked while this runs, m_cells can be read safely
+  if (m_cells.isNull()) {
+    delete oldNode;
+    return nullptr;
+  }
+
+  QSGNode *root = oldNode;
+  QSGSimpleTextureNode *checker, *cells;
+  if (!root) {
+    root = new QSGNode();
+    checker = new QSGSimpleTextureNode();
+    checker->setOwnsTexture(true);
+    checker->setFiltering(QSGTexture::Nearest);
+    cells = new QSGSimpleTextureNode();
+    cells->setOwnsTexture(true);
+    cells->setFiltering(QSGTexture::Nearest);
+    root->appendChildNode(checker);
+    root->appendChildNode(cells);
+    m_checkerDirty = m_cellsDirty = true;
+  } else {
+    checker = static_cast<QSGSimpleTextureNode *>(root->firstChild());
+    cells = static_cast<QSGSimpleTextureNode *>(root->lastChild());
+  }
+
+  if (m_checkerDirty) {
+    QImage image(m_cells.size(), QImage::Format_RGB32);
+    QRgb colors[2] = {m_checkerColor.rgb(), m_alternateCheckerColor.rgb()};
+    for (int y = 0; y < image.height(); ++y) {
+      QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+      for (int x = 0; x < image.width(); ++x) line[x] = colors[(x + y) % 2];
+    }
+    checker->setTexture(window()->createTextureFromImage(image));
+    m_checkerDirty = false;
+  }
+  if (m_cellsDirty) {
+    // the public scene graph API has no sub image upload, the whole grid
+    // image is small enough (64 KB at 128x128) to go in one piece
+    cells->setTexture(window()->createTextureFromImage(m_cells));
+    m_cellsDirty = false;
+  }
+
+  checker->setRect(boundingRect());
+  cells->setRect(boundingRect());
+  return root;
+}
+
+void PixelCanvas::geometryChange(const QRectF &newGeometry,
+                                 const QRectF &oldGeometry) {
+  QQuickItem::geometryChange(newGeometry, oldGeometry);
+  update();
+}
+
+void PixelCanvas::updateCells(const QList<int> &cells) {
+  if (!m_grid) return;
+
+  int width = m_grid->width();
+  for (int index : cells) {
+    m_cells.setPixel(index % width, index / width, cellColor(index));
+  }
+  m_cellsDirty = true;
+  update();
+}
+
+void PixelCanvas::resetCells() {
+  QSize size = m_grid ? QSize(m_grid->width(), m_grid->height()) : QSize();
+  if (size.isEmpty()) {
+    m_cells = QImage();
+  } else {
+    if (m_cells.size() != size) {
+      m_cells = QImage(size, QImage::Format_ARGB32_Premultiplied);
+      m_checkerDirty = true;
+    }
+    for (int y = 0; y < size.height(); ++y) {
+      QRgb *line = reinterpret_cast<QRgb *>(m_cells.scanLine(y));
+      for (int x = 0; x < size.width(); ++x) {
+        line[x] = cellColor(y * size.width() + x);
+      }
+    }
+  }
+  m_cellsDirty = true;
+  update();
+}
+
+QRgb PixelCanvas::cellColor(int index) const {
+  int color = int(quint8(m_grid->colorPlane()[index])) - 1;
+  if (color < 0) return qRgba(0, 0, 0, 0);
+  return qPremultiply(m_grid->paletteColor(color).rgba());
+}
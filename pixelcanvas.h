@@ -0,0 +1,64 @@
+#ifndef PIXELCANVAS_H
+#define PIXELCANVAS_H
+
+#include <QImage>
+#include <QPointer>
+#include <QQuickItem>
+
+#include "pixelgrid.h"
+
+/* PixelCanvas draws a PixelGrid through the scene graph. The grid is kept in
+ * an image with one texel per cell, transparent where the cell is empty,
+ * which is blended over a checkerboard texture of the same size. Both are
+ * stretched over the item with nearest filtering.
+ *
+ * The checkerboard texture is only recreated when the grid size or its
+ * colors change, and dirty cells only rewrite their own texels.
+ */
+class PixelCanvas : public QQuickItem {
+  Q_OBJECT
+  Q_PROPERTY(PixelGrid *grid READ grid WRITE setGrid NOTIFY gridChanged)
+  Q_PROPERTY(QColor checkerColor READ checkerColor WRITE setCheckerColor
+                 NOTIFY checkerChanged)
+  Q_PROPERTY(QColor alternateCheckerColor READ alternateCheckerColor WRITE
+                 setAlternateCheckerColor NOTIFY checkerChanged)
+
+ public:
+  PixelCanvas(QQuickItem *parent = 0);
+  ~PixelCanvas();
+
+  PixelGrid *grid() const;
+  QColor checkerColor() const;
+  QColor alternateCheckerColor() const;
+
+ public slots:
+  void setGrid(PixelGrid *grid);
+  void setCheckerColor(QColor color);
+  void setAlternateCheckerColor(QColor color);
+
+ signals:
+  void gridChanged(PixelGrid *grid);
+  void checkerChanged();
+
+ protected:
+  QSGNode *updatePaintNode(QSGNode *oldNode,
+                           UpdatePaintNodeData *updatePaintNodeData) override;
+  void geometryChange(const QRectF &newGeometry,
+                      const QRectF &oldGeometry) override;
+
+ private slots:
+  void updateCells(const QList<int> &cells);
+  void resetCells();
+
+ private:
+  QRgb cellColor(int index) const;
+
+  QPointer<PixelGrid> m_grid;
+  QColor m_checkerColor = QColor(230, 230, 230);
+  QColor m_alternateCheckerColor = QColor(217, 217, 217);
+  QImage m_cells;
+  bool m_cellsDirty = true;
+  bool m_checkerDirty = true;
+};
+
+#endif  // PIXELCANVAS_H
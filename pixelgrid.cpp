@@ -0,0 +1,484 @@
+#include "pixelgrid.h"
+
+#include <cstring>
+
+#include "projectformat.h"
+
+const char PixelGrid::kCompactAlphabet[] =
+    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+namespace {
+const int kCompactAlphabetSize = sizeof(PixelGrid::kCompactAlphabet) - 1;
+const QChar kCompactEmpty = '.';
+
+/* values holds one entry per cell of a row, empty is the value of empty
+ * cells. trailing empty cells are dropped
+ */
+QJsonValue encodeCompactRow(const QVector<int> &values, int empty) {
+  int length = values.size();
+  while (length > 0 && values[length - 1] == empty) --length;
+
+  bool fits = true;
+  for (int i = 0; i < length && fits; ++i) {
+    fits = values[i] == empty ||
+           (values[i] >= 0 && values[i] < kCompactAlphabetSize);
+  }
+  if (fits) {
+    QString row(length, kCompactEmpty);
+    for (int i = 0; i < length; ++i) {
+      if (values[i] != empty) row[i] = PixelGrid::kCompactAlphabet[values[i]];
+    }
+    return row;
+  }
+
+  QJsonArray row;
+  for (int i = 0; i < length; ++i) row.append(values[i]);
+  return row;
+}
+
+bool decodeCompactRow(const QJsonValue &value, int width, int empty,
+                      QVector<int> &values) {
+  values.fill(empty, width);
+  if (value.isString()) {
+    QString row = value.toString();
+    if (row.size() > width) return false;
+    for (int i = 0; i < row.size(); ++i) {
+      if (row[i] == kCompactEmpty) continue;
+      const char *found = row[i].unicode() < 128
+                              ? strchr(PixelGrid::kCompactAlphabet,
+                                       row[i].toLatin1())
+                              : nullptr;
+      if (!found || !*found) return false;
+      values[i] = found - PixelGrid::kCompactAlphabet;
+    }
+    return true;
+  }
+  if (value.isArray()) {
+    QJsonArray row = value.toArray();
+    if (row.size() > width) return false;
+    for (int i = 0; i < row.size(); ++i) values[i] = row[i].toInt(empty);
+    return true;
+  }
+  return false;
+}
+}  // namespace
+
+PixelGrid::PixelGrid(QObject *parent) : QObject(parent) {}
+
+PixelGrid::~PixelGrid() {}
+
+void PixelGrid::create(int width, int height) {
+  width = qMax(0, width);
+  height = qMax(0, height);
+  m_colors = QByteArray(width * height, '\0');
+  m_depths = QByteArray(width * height, '\0');
+  if (m_width != width || m_height != height) {
+    m_width = width;
+    m_height = height;
+    emit sizeChanged();
+  }
+  resetDirtyCells();
+  setJsonVersion("1.0");
+  emit gridChanged();
+}
+
+void PixelGrid::clear() {
+  m_colors.fill('\0');
+  m_depths.fill('\0');
+  resetDirtyCells();
+  emit gridChanged();
+}
+
+void PixelGrid::fill(const QColor &color, int depth) {
+  int index = paletteIndex(color);
+  if (index < 0) return;
+  m_colors.fill(char(index + 1));
+  m_depths.fill(char(qBound(1, depth, 255)));
+  resetDirtyCells();
+  emit gridChanged();
+}
+
+bool PixelGrid::isEmpty(int row, int col) const {
+  return !contains(row, col) || m_colors[row * m_width + col] == '\0';
+}
+
+QVariant PixelGrid::color(int row, int col) const {
+  // empty cells are null in QML, so `if (grid.color(row, col))` works
+  if (isEmpty(row, col)) return QVariant();
+  return paletteColor(quint8(m_colors[row * m_width + col]) - 1);
+}
+
+int PixelGrid::colorIndex(int row, int col) const {
+  if (!contains(row, col)) return -1;
+  return int(quint8(m_colors[row * m_width + col])) - 1;
+}
+
+int PixelGrid::depth(int row, int col) const {
+  if (!contains(row, col)) return 0;
+  return quint8(m_depths[row * m_width + col]);
+}
+
+bool PixelGrid::paint(int row, int col, const QColor &color) {
+  if (!contains(row, col)) return false;
+  int index = paletteIndex(color);
+  if (index < 0) return false;
+  int cell = row * m_width + col;
+  // freshly painted cells start with a depth of one
+  quint8 depth = qMax<quint8>(1, quint8(m_depths[cell]));
+  return setCellValue(cell, quint8(index + 1), depth);
+}
+
+bool PixelGrid::erase(int row, int col) {
+  if (!contains(row, col)) return false;
+  return setCellValue(row * m_width + col, 0, 0);
+}
+
+bool PixelGrid::setDepth(int row, int col, int depth) {
+  if (isEmpty(row, col)) return false;
+  int cell = row * m_width + col;
+  return setCellValue(cell, quint8(m_colors[cell]),
+                      quint8(qBound(1, depth, 255)));
+}
+
+bool PixelGrid::setCell(int row, int col, int colorIndex, int depth) {
+  if (!contains(row, col) || colorIndex >= m_palette.size()) return false;
+  if (colorIndex < 0) return erase(row, col);
+  return setCellValue(row * m_width + col, quint8(colorIndex + 1),
+                      quint8(qBound(1, depth, 255)));
+}
+
+int PixelGrid::paletteIndex(const QColor &color) {
+  /* colors are interned into the palette, the comparison is done on 8 bit
+   * channels because QML hands colors over as floating point values
+   */
+  if (!color.isValid()) return -1;
+  for (int i = 0; i < m_palette.size(); ++i) {
+    if (m_palette[i].rgba() == color.rgba()) return i;
+  }
+  if (m_palette.size() >= kMaxPaletteSize) {
+    qWarning() << "Palette is full, can't add" << color.name();
+    return -1;
+  }
+  m_palette.append(QColor::fromRgba(color.rgba()));
+  emit paletteChanged();
+  return m_palette.size() - 1;
+}
+
+int PixelGrid::paintCells(const QVector<int> &cells, int colorIndex) {
+  if (colorIndex >= m_palette.size()) return 0;
+
+  int changed = 0;
+  for (int cell : cells) {
+    if (cell < 0 || cell >= m_width * m_height) continue;
+    quint8 color = colorIndex < 0 ? 0 : quint8(colorIndex + 1);
+    quint8 depth = colorIndex < 0 ? 0 : qMax<quint8>(1, quint8(m_depths[cell]));
+    if (writeCell(cell, color, depth)) ++changed;
+  }
+  if (changed) flushDirtyCells();
+  return changed;
+}
+
+int PixelGrid::setCellValues(const QVector<int> &cells,
+                             const QByteArray &colors,
+                             const QByteArray &depths) {
+  int changed = 0;
+  for (int i = 0; i < cells.size(); ++i) {
+    int cell = cells[i];
+    if (cell < 0 || cell >= m_width * m_height) continue;
+    quint8 color = quint8(colors[i]);
+    if (color > m_palette.size()) continue;
+    if (writeCell(cell, color, color ? quint8(depths[i]) : 0)) ++changed;
+  }
+  if (changed) flushDirtyCells();
+  return changed;
+}
+
+QJsonObject PixelGrid::toJson() const {
+  // version 1.0 layout, one object per cell
+  QJsonArray pixels;
+  for (int row = 0; row < m_height; ++row) {
+    QJsonArray pixelRow;
+    for (int col = 0; col < m_width; ++col) {
+      bool empty = isEmpty(row, col);
+      pixelRow.append(QJsonObject{
+          {"color", empty ? QJsonValue()
+                          : QJsonValue(paletteColor(colorIndex(row, col))
+                                           .name())},
+          {"depth", depth(row, col)},
+          {"shape", empty ? QJsonValue() : QJsonValue("cube")}});
+    }
+    pixels.append(pixelRow);
+  }
+  return QJsonObject{{"version", "1.0"},
+                     {"palette", QJsonArray::fromStringList(palette())},
+                     {"width", m_width},
+                     {"height", m_height},
+                     {"pixels", pixels}};
+}
+
+QJsonObject PixelGrid::toCompactJson() const {
+  QJsonArray pixels, depths;
+  QVector<int> colorRow(m_width), depthRow(m_width);
+  for (int row = 0; row < m_height; ++row) {
+    for (int col = 0; col < m_width; ++col) {
+      colorRow[col] = colorIndex(row, col);
+      depthRow[col] = depth(row, col);
+    }
+    pixels.append(encodeCompactRow(colorRow, -1));
+    depths.append(encodeCompactRow(depthRow, 0));
+  }
+  return QJsonObject{{"version", "1.1"},
+                     {"palette", QJsonArray::fromStringList(palette())},
+                     {"width", m_width},
+                     {"height", m_height},
+                     {"shape", "cube"},
+                     {"pixels", pixels},
+                     {"depths", depths}};
+}
+
+bool PixelGrid::fromJson(const QJsonObject &data) {
+  QString version = data.value("version").toString();
+  if (version == "1.1") {
+    if (!fromCompactJson(data)) return false;
+    setJsonVersion(version);
+    return true;
+  }
+  if (version != "1.0") {
+    qWarning() << "Invalid version number [1.0 != " + version + "]";
+    return false;
+  }
+  int width = data.value("width").toInt();
+  int height = data.value("height").toInt();
+  QJsonArray pixels = data.value("pixels").toArray();
+  if (width <= 0 || height <= 0 || pixels.size() != height) {
+    qWarning() << "Invalid grid size";
+    return false;
+  }
+
+  QVector<QColor> palette;
+  for (const QJsonValue &value : data.value("palette").toArray()) {
+    palette.append(QColor(value.toString()));
+  }
+  if (palette.size() > kMaxPaletteSize) {
+    qWarning() << "Palette is too large";
+    return false;
+  }
+
+  m_palette = palette;
+  m_colors = QByteArray(width * height, '\0');
+  m_depths = QByteArray(width * height, '\0');
+  bool resized = m_width != width || m_height != height;
+  m_width = width;
+  m_height = height;
+
+  for (int row = 0; row < height; ++row) {
+    QJsonArray pixelRow = pixels[row].toArray();
+    for (int col = 0; col < qMin(width, pixelRow.size()); ++col) {
+      QJsonObject item = pixelRow[col].toObject();
+      QJsonValue itemColor = item.value("color");
+      if (itemColor.isNull() || itemColor.isUndefined()) continue;
+      int index = paletteIndex(QColor(itemColor.toString()));
+      if (index < 0) continue;
+      m_colors[row * width + col] = char(index + 1);
+      m_depths[row * width + col] =
+          char(qBound(1, item.value("depth").toInt(), 255));
+    }
+  }
+  setJsonVersion(version);
+
+  if (resized) emit sizeChanged();
+  resetDirtyCells();
+  emit paletteChanged();
+  emit gridChanged();
+  return true;
+}
+
+bool PixelGrid::loadJson(const QString &text) {
+  QString message;
+  if (!ProjectFormat::fromJson(text.toUtf8(), *this, &message)) {
+    qWarning() << "Can't load project:" << message;
+    return false;
+  }
+  return true;
+}
+
+bool PixelGrid::fromCompactJson(const QJsonObject &data) {
+  int width = data.value("width").toInt();
+  int height = data.value("height").toInt();
+  QJsonArray pixels = data.value("pixels").toArray();
+  QJsonArray depths = data.value("depths").toArray();
+  if (width <= 0 || height <= 0 || pixels.size() != height ||
+      depths.size() != height) {
+    qWarning() << "Invalid grid size";
+    return false;
+  }
+
+  QVector<QColor> palette;
+  for (const QJsonValue &value : data.value("palette").toArray()) {
+    palette.append(QColor(value.toString()));
+  }
+
+  QByteArray colors(width * height, '\0'), cellDepths(width * height, '\0');
+  QVector<int> colorRow, depthRow;
+  for (int row = 0; row < height; ++row) {
+    if (!decodeCompactRow(pixels[row], width, -1, colorRow) ||
+        !decodeCompactRow(depths[row], width, 0, depthRow)) {
+      qWarning() << "Invalid row" << row;
+      return false;
+    }
+    for (int col = 0; col < width; ++col) {
+      if (colorRow[col] < 0) continue;
+      if (colorRow[col] >= palette.size()) {
+        qWarning() << "Invalid color index in row" << row;
+        return false;
+      }
+      colors[row * width + col] = char(colorRow[col] + 1);
+      cellDepths[row * width + col] = char(qBound(1, depthRow[col], 255));
+    }
+  }
+  return assign(width, height, palette, colors, cellDepths);
+}
+
+bool PixelGrid::assign(int width, int height, const QVector<QColor> &palette,
+                       const QByteArray &colors, const QByteArray &depths) {
+  if (width <= 0 || height <= 0 || palette.size() > kMaxPaletteSize ||
+      colors.size() != width * height || depths.size() != width * height)
+    return false;
+  QByteArray cellDepths = depths;
+  for (int i = 0; i < colors.size(); ++i) {
+    quint8 color = quint8(colors[i]);
+    if (color > palette.size()) return false;
+    // keep the invariant of painted cells having a depth of at least one
+    if (color == 0) {
+      cellDepths[i] = '\0';
+    } else if (cellDepths[i] == '\0') {
+      cellDepths[i] = char(1);
+    }
+  }
+
+  bool resized = m_width != width || m_height != height;
+  m_width = width;
+  m_height = height;
+  m_palette = palette;
+  m_colors = colors;
+  m_depths = cellDepths;
+
+  if (resized) emit sizeChanged();
+  resetDirtyCells();
+  emit paletteChanged();
+  emit gridChanged();
+  return true;
+}
+
+int PixelGrid::width() const { return m_width; }
+
+int PixelGrid::height() const { return m_height; }
+
+QString PixelGrid::jsonVersion() const { return m_jsonVersion; }
+
+QQuickWindow *PixelGrid::window() const { return m_window; }
+
+QStringList PixelGrid::palette() const {
+  QStringList names;
+  for (const QColor &color : m_palette) names.append(color.name());
+  return names;
+}
+
+QColor PixelGrid::paletteColor(int index) const {
+  if (index < 0 || index >= m_palette.size()) return QColor();
+  return m_palette[index];
+}
+
+const QByteArray &PixelGrid::colorPlane() const { return m_colors; }
+
+const QByteArray &PixelGrid::depthPlane() const { return m_depths; }
+
+void PixelGrid::setPalette(QStringList palette) {
+  QVector<QColor> colors;
+  for (const QString &name : palette) colors.append(QColor(name));
+  if (colors.size() > kMaxPaletteSize) colors.resize(kMaxPaletteSize);
+  if (m_palette == colors) return;
+
+  m_palette = colors;
+  emit paletteChanged();
+}
+
+void PixelGrid::setJsonVersion(QString jsonVersion) {
+  if (m_jsonVersion == jsonVersion) return;
+  if (jsonVersion != "1.0" && jsonVersion != "1.1") {
+    qWarning() << "Unknown JSON version" << jsonVersion;
+    return;
+  }
+
+  m_jsonVersion = jsonVersion;
+  emit jsonVersionChanged(jsonVersion);
+}
+
+void PixelGrid::setWindow(QQuickWindow *window) {
+  if (m_window == window) return;
+
+  // whatever is pending was scheduled for the old window
+  flushDirtyCells();
+  if (m_window) disconnect(m_window, nullptr, this, nullptr);
+  m_window = window;
+  if (m_window) {
+    // afterAnimating is emitted on the gui thread, once per frame
+    connect(m_window, &QQuickWindow::afterAnimating, this,
+            &PixelGrid::flushDirtyCells);
+    // a window hidden before its frame came would hold the cells back
+    connect(m_window, &QWindow::visibilityChanged, this, [this]() {
+      if (m_flushScheduled && !m_window->isExposed()) flushDirtyCells();
+    });
+  }
+  emit windowChanged(window);
+}
+
+bool PixelGrid::contains(int row, int col) const {
+  return row >= 0 && row < m_height && col >= 0 && col < m_width;
+}
+
+bool PixelGrid::setCellValue(int index, quint8 color, quint8 depth) {
+  if (!writeCell(index, color, depth)) return false;
+  emit cellChanged(index / m_width, index % m_width);
+  return true;
+}
+
+bool PixelGrid::writeCell(int index, quint8 color, quint8 depth) {
+  if (quint8(m_colors[index]) == color && quint8(m_depths[index]) == depth)
+    return false;
+  m_colors[index] = char(color);
+  m_depths[index] = char(depth);
+  markDirty(index);
+  return true;
+}
+
+void PixelGrid::markDirty(int index) {
+  if (m_dirtyMask.testBit(index)) return;
+  m_dirtyMask.setBit(index);
+  m_dirtyCells.append(index);
+  if (!m_flushScheduled) {
+    m_flushScheduled = true;
+    if (m_window && m_window->isExposed()) {
+      // asks for a frame, its afterAnimating drains the cells
+      m_window->update();
+    } else {
+      QMetaObject::invokeMethod(this, "flushDirtyCells", Qt::QueuedConnection);
+    }
+  }
+}
+
+void PixelGrid::resetDirtyCells() {
+  // a full grid change supersedes whatever single cells were pending
+  m_dirtyCells.clear();
+  m_dirtyMask = QBitArray(m_width * m_height);
+}
+
+void PixelGrid::flushDirtyCells() {
+  m_flushScheduled = false;
+  if (m_dirtyCells.isEmpty()) return;
+
+  QList<int> cells;
+  cells.swap(m_dirtyCells);
+  for (int index : cells) m_dirtyMask.clearBit(index);
+  emit cellsChanged(cells);
+}
@@ -0,0 +1,129 @@
+#ifndef PIXELGRID_H
+#define PIXELGRID_H
+
+#include <QColor>
+#include <QPointer>
+#include <QQuickWindow>
+#include <QtCore>
+
+/* PixelGrid is the native model behind the editor. Cells are stored row
+ * major in two contiguous byte planes: a palette index plane where 0 marks
+ * an empty cell and n refers to palette entry n - 1, and a depth plane.
+ * A 256x256 grid therefore takes 128 KB.
+ *
+ * Edits are collected in a dirty cell set which is broadcast through
+ * cellsChanged so views only touch the cells that actually changed. With a
+ * window set the set is drained once per frame, from afterAnimating right
+ * before the scene graph is synchronized. Without one, e.g. in headless
+ * exports, or while the window isn't exposed and draws no frames, it is
+ * drained once per event loop pass.
+ *
+ * Two JSON layouts are understood. Version 1.0 has an object per cell.
+ * Version 1.1 (toCompactJson) stores each row in "pixels" as a string with
+ * one character per cell, '.' for empty cells and kCompactAlphabet[i] for
+ * palette entry i, with trailing empty cells left out. "depths" holds the
+ * depths in the same way and "shape" names the shape of all cells. Rows
+ * that don't fit the alphabet are written as arrays of numbers, -1 (or 0
+ * for depths) marking empty cells. Older builds only read 1.0, so 1.1 is
+ * only saved when jsonVersion asks for it.
+ */
+class PixelGrid : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(PixelGrid)
+  Q_PROPERTY(int width READ width NOTIFY sizeChanged)
+  Q_PROPERTY(int height READ height NOTIFY sizeChanged)
+  Q_PROPERTY(QStringList palette READ palette WRITE setPalette NOTIFY
+                 paletteChanged)
+  // the JSON layout projects are saved in, kept from the loaded file
+  Q_PROPERTY(QString jsonVersion READ jsonVersion WRITE setJsonVersion NOTIFY
+                 jsonVersionChanged)
+  Q_PROPERTY(QQuickWindow *window READ window WRITE setWindow NOTIFY
+                 windowChanged)
+
+ public:
+  static const int kMaxPaletteSize = 255;
+  static const char kCompactAlphabet[];
+
+  PixelGrid(QObject *parent = 0);
+  ~PixelGrid();
+
+  Q_INVOKABLE void create(int width, int height);
+  Q_INVOKABLE void clear();
+  Q_INVOKABLE void fill(const QColor &color, int depth = 1);
+
+  Q_INVOKABLE bool isEmpty(int row, int col) const;
+  Q_INVOKABLE QVariant color(int row, int col) const;
+  Q_INVOKABLE int colorIndex(int row, int col) const;
+  Q_INVOKABLE int depth(int row, int col) const;
+
+  Q_INVOKABLE bool paint(int row, int col, const QColor &color);
+  Q_INVOKABLE bool erase(int row, int col);
+  Q_INVOKABLE bool setDepth(int row, int col, int depth);
+  Q_INVOKABLE bool setCell(int row, int col, int colorIndex, int depth);
+  Q_INVOKABLE int paletteIndex(const QColor &color);
+
+  // paints (or with colorIndex -1 erases) many cells as one edit, the
+  // change is reported right away through a single cellsChanged
+  int paintCells(const QVector<int> &cells, int colorIndex);
+  // raw plane values per cell, as read from colorPlane() and depthPlane()
+  int setCellValues(const QVector<int> &cells, const QByteArray &colors,
+                    const QByteArray &depths);
+
+  Q_INVOKABLE QJsonObject toJson() const;
+  Q_INVOKABLE QJsonObject toCompactJson() const;
+  Q_INVOKABLE bool fromJson(const QJsonObject &data);
+  // parses a whole JSON document, see ProjectFormat::fromJson
+  Q_INVOKABLE bool loadJson(const QString &text);
+  // replaces the whole grid with planes in the colorPlane/depthPlane layout
+  bool assign(int width, int height, const QVector<QColor> &palette,
+              const QByteArray &colors, const QByteArray &depths);
+
+  int width() const;
+  int height() const;
+  QStringList palette() const;
+  QColor paletteColor(int index) const;
+  QString jsonVersion() const;
+  QQuickWindow *window() const;
+
+  // raw planes for native consumers, see the class comment for the layout
+  const QByteArray &colorPlane() const;
+  const QByteArray &depthPlane() const;
+
+ public slots:
+  void setPalette(QStringList palette);
+  void setJsonVersion(QString jsonVersion);
+  void setWindow(QQuickWindow *window);
+  // reports pending cell edits now instead of on the next event loop pass
+  void flushDirtyCells();
+
+ signals:
+  void sizeChanged();
+  void paletteChanged();
+  void cellChanged(int row, int col);  // single cell edits only
+  // row * width + col, once per frame, see the class comment
+  void cellsChanged(QList<int> cells);
+  void gridChanged();  // many cells changed at once, e.g. after a load
+  void jsonVersionChanged(QString jsonVersion);
+  void windowChanged(QQuickWindow *window);
+
+ private:
+  bool contains(int row, int col) const;
+  bool fromCompactJson(const QJsonObject &data);
+  bool setCellValue(int index, quint8 color, quint8 depth);
+  bool writeCell(int index, quint8 color, quint8 depth);
+  void markDirty(int index);
+  void resetDirtyCells();
+
+  int m_width = 0;
+  int m_height = 0;
+  QByteArray m_colors;
+  QByteArray m_depths;
+  QVector<QColor> m_palette;
+  QList<int> m_dirtyCells;
+  QBitArray m_dirtyMask;
+  bool m_flushScheduled = false;
+  QString m_jsonVersion = "1.0";
+  QPointer<QQuickWindow> m_window;  // paces the flushes of dirty cells
+};
+
+#endif  // PIXELGRID_H
@@ -0,0 +1,186 @@
+#include "projectformat.h"
+
+#include <cstring>
+
+#include "pixelgrid.h"
+#include "projectparser.h"
+
+namespace {
+const quint32 kMagic = 0x424D4D50;  // "PMMB"
+const quint16 kVersion = 1;
+const int kMaxRun = 255;
+// refuse absurd sizes before allocating the planes
+const quint32 kMaxSide = 16384;
+
+QByteArray encodeRuns(const QByteArray &plane) {
+  QByteArray runs;
+  int size = plane.size();
+  for (int i = 0; i < size;) {
+    char value = plane[i];
+    int run = 1;
+    while (i + run < size && run < kMaxRun && plane[i + run] == value) ++run;
+    runs.append(char(run));
+    runs.append(value);
+    i += run;
+  }
+  return runs;
+}
+
+bool decodeRuns(const QByteArray &runs, int size, QByteArray &plane) {
+  plane = QByteArray(size, Qt::Uninitialized);
+  int offset = 0;
+  for (int i = 0; i + 1 < runs.size(); i += 2) {
+    int run = quint8(runs[i]);
+    if (run == 0 || offset + run > size) return false;
+    memset(plane.data() + offset, runs[i + 1], run);
+    offset += run;
+  }
+  return runs.size() % 2 == 0 && offset == size;
+}
+
+bool fail(QString *error, const QString &message) {
+  if (error) *error = message;
+  return false;
+}
+}  // namespace
+
+ProjectFormat::Format ProjectFormat::formatForFile(const QString &fileName) {
+  return QFileInfo(fileName).suffix().toLower() == "pmm" ? Binary : Json;
+}
+
+QByteArray ProjectFormat::toBinary(const PixelGrid &grid) {
+  QByteArray data;
+  QDataStream stream(&data, QIODevice::WriteOnly);
+  stream.setByteOrder(QDataStream::LittleEndian);
+  stream << kMagic << kVersion << quint16(0) << quint32(grid.width())
+         << quint32(grid.height());
+
+  QStringList palette = grid.palette();
+  stream << quint16(palette.size()) << quint16(0);
+  for (int i = 0; i < palette.size(); ++i) {
+    stream << quint32(grid.paletteColor(i).rgba());
+  }
+
+  for (const QByteArray &plane : {grid.colorPlane(), grid.depthPlane()}) {
+    QByteArray runs = encodeRuns(plane);
+    stream << quint32(runs.size());
+    stream.writeRawData(runs.constData(), runs.size());
+  }
+  return data;
+}
+
+bool ProjectFormat::fromBinary(const QByteArray &data, PixelGrid &grid,
+                               QString *error) {
+  QDataStream stream(data);
+  stream.setByteOrder(QDataStream::LittleEndian);
+  quint32 magic, width, height;
+  quint16 version, reserved, paletteSize;
+  stream >> magic >> version >> reserved >> width >> height;
+  if (stream.status() != QDataStream::Ok || magic != kMagic)
+    return fail(error, "Not a Pixel Model Maker project");
+  if (version != kVersion)
+    return fail(error, QString("Unsupported version %1").arg(version));
+  if (width == 0 || height == 0 || width > kMaxSide || height > kMaxSide)
+    return fail(error, "Invalid grid size");
+
+  stream >> paletteSize >> reserved;
+  if (paletteSize > PixelGrid::kMaxPaletteSize)
+    return fail(error, "Palette is too large");
+  QVector<QColor> palette;
+  for (int i = 0; i < paletteSize; ++i) {
+    quint32 rgba;
+    stream >> rgba;
+    palette.append(QColor::fromRgba(rgba));
+  }
+
+  QByteArray planes[2];
+  for (QByteArray &plane : planes) {
+    quint32 size;
+    stream >> size;
+    if (stream.status() != QDataStream::Ok || size > quint32(data.size()))
+      return fail(error, "Truncated file");
+    QByteArray runs(size, Qt::Uninitialized);
+    if (stream.readRawData(runs.data(), size) != int(size) ||
+        !decodeRuns(runs, width * height, plane))
+      return fail(error, "Corrupt cell data");
+  }
+
+  if (!grid.assign(width, height, palette, planes[0], planes[1]))
+    return fail(error, "Cells refer to colors outside of the palette");
+  return true;
+}
+
+QByteArray ProjectFormat::toJson(const PixelGrid &grid) {
+  QJsonObject object =
+      grid.jsonVersion() == "1.1" ? grid.toCompactJson() : grid.toJson();
+  /* QJsonObject sorts its keys, which puts "pixels" before "version". the
+   * version is written first by hand, so ProjectParser knows the layout
+   * before it reaches the pixels
+   */
+  QByteArray version = object.take("version").toString().toUtf8();
+  QByteArray json = QJsonDocument(object).toJson(QJsonDocument::Indented);
+  json.insert(1, "\n    \"version\": \"" + version + "\"" +
+                     (object.isEmpty() ? "" : ","));
+  return json;
+}
+
+bool ProjectFormat::fromJson(const QByteArray &data, PixelGrid &grid,
+                             QString *error) {
+  // version 1.0 documents are read without building a QJsonDocument
+  QString message;
+  switch (ProjectParser(data).parse(grid, &message)) {
+    case ProjectParser::Parsed:
+      return true;
+    case ProjectParser::Invalid:
+      return fail(error, message);
+    case ProjectParser::Unsupported:
+      break;
+  }
+
+  QJsonParseError parseError;
+  QJsonDocument document = QJsonDocument::fromJson(data, &parseError);
+  if (parseError.error != QJsonParseError::NoError)
+    return fail(error, parseError.errorString());
+  if (!grid.fromJson(document.object()))
+    return fail(error, "Invalid file or incompatible version");
+  return true;
+}
+
+bool ProjectFormat::read(const QString &fileName, PixelGrid &grid,
+                         QString *error) {
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly)) return fail(error, file.errorString());
+  /* the parsers only look at the bytes, so they can work on the mapped file
+   * directly instead of a copy. the mapping goes away with the file
+   */
+  qint64 size = file.size();
+  uchar *mapped = size > 0 ? file.map(0, size) : nullptr;
+  QByteArray data =
+      mapped ? QByteArray::fromRawData(reinterpret_cast<const char *>(mapped),
+                                       size)
+             : file.readAll();
+  return formatForFile(fileName) == Binary ? fromBinary(data, grid, error)
+                                           : fromJson(data, grid, error);
+}
+
+bool ProjectFormat::write(const QString &fileName, const PixelGrid &grid,
+                          QString *error) {
+  QSaveFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly)) return fail(error, file.errorString());
+  QByteArray bytes =
+      formatForFile(fileName) == Binary ? toBinary(grid) : toJson(grid);
+  if (file.write(bytes) != bytes.size()) {
+    // a short write must not replace the project
+    QString message = file.errorString();
+    file.cancelWriting();
+    return fail(error, message);
+  }
+  if (!file.commit()) return fail(error, file.errorString());
+  return true;
+}
+
+bool ProjectFormat::convert(const QString &source, const QString &target,
+                            QString *error) {
+  PixelGrid grid;
+  return read(source, grid, error) && write(target, grid, error);
+}
@@ -0,0 +1,45 @@
+#ifndef PROJECTFORMAT_H
+#define PROJECTFORMAT_H
+
+#include <QtCore>
+
+class PixelGrid;
+
+/* ProjectFormat reads and writes PixelGrid projects. Two formats exist:
+ *
+ * - JSON (.json), version 1.0 or the sparse 1.1 layout described in
+ *   PixelGrid, written in the layout named by PixelGrid::jsonVersion
+ * - a binary format (.pmm), all integers little endian:
+ *     magic "PMMB", quint16 version (1), quint16 reserved,
+ *     quint32 width, quint32 height,
+ *     quint16 palette size, quint16 reserved, palette as quint32 ARGB,
+ *     quint32 byte count + run length encoded color index plane,
+ *     quint32 byte count + run length encoded depth plane.
+ *   Planes use the PixelGrid layout (color 0 is empty, n is palette entry
+ *   n - 1) and are stored as (run length 1..255, value) byte pairs.
+ *
+ * Both hold exactly what a PixelGrid holds, so converting is lossless.
+ */
+class ProjectFormat {
+ public:
+  enum Format { Json, Binary };
+
+  static Format formatForFile(const QString &fileName);
+
+  static QByteArray toBinary(const PixelGrid &grid);
+  static bool fromBinary(const QByteArray &data, PixelGrid &grid,
+                         QString *error = nullptr);
+  static QByteArray toJson(const PixelGrid &grid);
+  static bool fromJson(const QByteArray &data, PixelGrid &grid,
+                       QString *error = nullptr);
+
+  // pick the format from the file suffix, read maps the file into memory
+  static bool read(const QString &fileName, PixelGrid &grid,
+                   QString *error = nullptr);
+  static bool write(const QString &fileName, const PixelGrid &grid,
+                    QString *error = nullptr);
+  static bool convert(const QString &source, const QString &target,
+                      QString *error = nullptr);
+};
+
+#endif  // PROJECTFORMAT_H
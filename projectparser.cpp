@@ -0,0 +1,375 @@
+#include "projectparser.h"
+
+#include <climits>
+#include <cstring>
+
+#include "pixelgrid.h"
+
+namespace {
+// same limit as the binary format, checked before the planes are allocated
+const int kMaxSide = 16384;
+// arrays and objects nested deeper than this are rejected
+const int kMaxNesting = 64;
+}  // namespace
+
+ProjectParser::ProjectParser(const QByteArray &data)
+    : m_begin(data.constData()),
+      m_pos(data.constData()),
+      m_end(data.constData() + data.size()) {}
+
+ProjectParser::Result ProjectParser::parse(PixelGrid &grid, QString *error) {
+  auto invalid = [&]() {
+    if (error) *error = m_error;
+    return Invalid;
+  };
+
+  skipSpace();
+  if (!consume('{')) {
+    fail("Expected an object");
+    return invalid();
+  }
+  skipSpace();
+  bool first = true;
+  while (!consume('}')) {
+    if (!first && !consume(',')) {
+      fail("Expected ',' or '}'");
+      return invalid();
+    }
+    first = false;
+    skipSpace();
+    QByteArray key;
+    if (!parseString(key)) return invalid();
+    skipSpace();
+    if (!consume(':')) {
+      fail("Expected ':'");
+      return invalid();
+    }
+    skipSpace();
+
+    bool ok;
+    if (key == "version") {
+      ok = parseString(m_version);
+      /* ProjectFormat writes the version first, so other versions cost no
+       * full scan. documents with the version after the pixels still stop
+       * at their first cell that isn't a v1.0 cell object
+       */
+      if (ok && m_version != "1.0") return Unsupported;
+    } else if (key == "width") {
+      ok = parseInt(m_width);
+    } else if (key == "height") {
+      ok = parseInt(m_height);
+    } else if (key == "palette") {
+      ok = parsePalette();
+    } else if (key == "pixels") {
+      ok = parsePixels();
+    } else {
+      ok = skipValue();
+    }
+    if (!ok) {
+      // pixels of another layout, unless the document claims to be 1.0
+      if (m_unknownLayout && m_version.isEmpty()) return Unsupported;
+      if (m_unknownLayout) fail("Pixels are not rows of cells");
+      return invalid();
+    }
+    skipSpace();
+  }
+  skipSpace();
+  if (m_pos != m_end) {
+    fail("Unexpected data after the project");
+    return invalid();
+  }
+
+  if (m_version != "1.0") return Unsupported;
+  if (m_width <= 0 || m_height <= 0 || m_width > kMaxSide ||
+      m_height > kMaxSide || m_rowLengths.size() != m_height) {
+    m_error = "Invalid grid size";
+    return invalid();
+  }
+  if (m_palette.size() > PixelGrid::kMaxPaletteSize) {
+    m_error = "Palette is too large";
+    return invalid();
+  }
+
+  /* cell colors missing from the palette are added to it like
+   * PixelGrid::paletteIndex does, cells that don't fit stay empty
+   */
+  QVector<QColor> palette = m_palette;
+  quint8 remap[256] = {0};
+  for (int id = 0; id < m_cellColors.size(); ++id) {
+    QRgb rgba = m_cellColors[id];
+    int index = 0;
+    while (index < palette.size() && palette[index].rgba() != rgba) ++index;
+    if (index == palette.size()) {
+      if (palette.size() >= PixelGrid::kMaxPaletteSize) continue;
+      palette.append(QColor::fromRgba(rgba));
+    }
+    remap[id + 1] = quint8(index + 1);
+  }
+
+  int size = m_width * m_height;
+  QByteArray colors(size, '\0'), depths(size, '\0');
+  int offset = 0;
+  for (int row = 0; row < m_height; ++row) {
+    int length = m_rowLengths[row];
+    int cells = qMin(length, m_width);
+    for (int col = 0; col < cells; ++col) {
+      quint8 color = remap[quint8(m_colors[offset + col])];
+      if (color == 0) continue;
+      colors[row * m_width + col] = char(color);
+      depths[row * m_width + col] = m_depths[offset + col];
+    }
+    offset += length;
+  }
+
+  if (!grid.assign(m_width, m_height, palette, colors, depths)) {
+    m_error = "Invalid project";
+    return invalid();
+  }
+  grid.setJsonVersion(m_version);
+  return Parsed;
+}
+
+bool ProjectParser::fail(const char *message) {
+  if (m_error.isEmpty()) {
+    m_error = QString("%1 at offset %2").arg(message).arg(m_pos - m_begin);
+  }
+  return false;
+}
+
+void ProjectParser::skipSpace() {
+  while (m_pos < m_end &&
+         (*m_pos == ' ' || *m_pos == '\n' || *m_pos == '\r' || *m_pos == '\t'))
+    ++m_pos;
+}
+
+bool ProjectParser::consume(char c) {
+  if (m_pos < m_end && *m_pos == c) {
+    ++m_pos;
+    return true;
+  }
+  return false;
+}
+
+bool ProjectParser::parseString(QByteArray &value) {
+  if (!consume('"')) return fail("Expected a string");
+  const char *start = m_pos;
+  while (m_pos < m_end && *m_pos != '"' && *m_pos != '\\') ++m_pos;
+  value = QByteArray(start, m_pos - start);
+  // escapes are rare in projects, only then the slow path is taken
+  while (m_pos < m_end && *m_pos == '\\') {
+    if (++m_pos == m_end) break;
+    char c = *m_pos++;
+    switch (c) {
+      case '"': case '\\': case '/': value.append(c); break;
+      case 'b': value.append('\b'); break;
+      case 'f': value.append('\f'); break;
+      case 'n': value.append('\n'); break;
+      case 'r': value.append('\r'); break;
+      case 't': value.append('\t'); break;
+      case 'u': {
+        if (m_end - m_pos < 4) return fail("Truncated escape");
+        bool ok;
+        uint code = QByteArray(m_pos, 4).toUInt(&ok, 16);
+        if (!ok) return fail("Invalid escape");
+        m_pos += 4;
+        value.append(QString(QChar(code)).toUtf8());
+        break;
+      }
+      default:
+        return fail("Invalid escape");
+    }
+    start = m_pos;
+    while (m_pos < m_end && *m_pos != '"' && *m_pos != '\\') ++m_pos;
+    value.append(start, m_pos - start);
+  }
+  if (!consume('"')) return fail("Unterminated string");
+  return true;
+}
+
+bool ProjectParser::parseNumber(double &value) {
+  const char *start = m_pos;
+  if (m_pos < m_end && *m_pos == '-') ++m_pos;
+  while (m_pos < m_end && ((*m_pos >= '0' && *m_pos <= '9') || *m_pos == '.' ||
+                           *m_pos == 'e' || *m_pos == 'E' || *m_pos == '+' ||
+                           *m_pos == '-'))
+    ++m_pos;
+  bool ok = false;
+  if (m_pos > start) value = QByteArray(start, m_pos - start).toDouble(&ok);
+  if (!ok) {
+    m_pos = start;
+    return fail("Expected a number");
+  }
+  return true;
+}
+
+bool ProjectParser::parseInt(int &value) {
+  // plain integers are by far the most common, they are read in place
+  const char *pos = m_pos;
+  bool negative = pos < m_end && *pos == '-';
+  if (negative) ++pos;
+  const char *digits = pos;
+  qint64 integer = 0;
+  while (pos < m_end && *pos >= '0' && *pos <= '9' && pos - digits < 10)
+    integer = integer * 10 + (*pos++ - '0');
+  bool plain = pos > digits && (pos == m_end || !strchr("0123456789.eE", *pos));
+  if (negative) integer = -integer;
+  if (plain && integer >= INT_MIN && integer <= INT_MAX) {
+    value = int(integer);
+    m_pos = pos;
+    return true;
+  }
+
+  double number;
+  if (!parseNumber(number)) return false;
+  if (number != qint64(number) || number < INT_MIN || number > INT_MAX)
+    return fail("Expected an integer");
+  value = int(number);
+  return true;
+}
+
+bool ProjectParser::skipValue(int level) {
+  if (level > kMaxNesting) return fail("Nesting is too deep");
+  if (m_pos == m_end) return fail("Unexpected end of data");
+
+  QByteArray text;
+  double number;
+  switch (*m_pos) {
+    case '"':
+      return parseString(text);
+    case '{':
+    case '[': {
+      char close = *m_pos == '{' ? '}' : ']';
+      ++m_pos;
+      skipSpace();
+      bool first = true;
+      while (!consume(close)) {
+        if (!first && !consume(',')) return fail("Expected ','");
+        first = false;
+        skipSpace();
+        if (close == '}') {
+          if (!parseString(text)) return false;
+          skipSpace();
+          if (!consume(':')) return fail("Expected ':'");
+          skipSpace();
+        }
+        if (!skipValue(level + 1)) return false;
+        skipSpace();
+      }
+      return true;
+    }
+    case 't':
+    case 'f':
+    case 'n':
+      for (const char *literal : {"true", "false", "null"}) {
+        int length = int(strlen(literal));
+        if (m_end - m_pos >= length && !memcmp(m_pos, literal, length)) {
+          m_pos += length;
+          return true;
+        }
+      }
+      return fail("Invalid literal");
+    default:
+      return parseNumber(number);
+  }
+}
+
+bool ProjectParser::parsePalette() {
+  if (!consume('[')) return fail("Expected the palette array");
+  skipSpace();
+  QByteArray name;
+  while (!consume(']')) {
+    if (!m_palette.isEmpty() && !consume(',')) return fail("Expected ','");
+    skipSpace();
+    if (!parseString(name)) return false;
+    QColor color(QString::fromUtf8(name));
+    if (!color.isValid()) return fail("Invalid palette color");
+    m_palette.append(color);
+    skipSpace();
+  }
+  return true;
+}
+
+bool ProjectParser::parsePixels() {
+  if (!consume('[')) return fail("Expected the pixels array");
+  skipSpace();
+  while (!consume(']')) {
+    if (!m_rowLengths.isEmpty() && !consume(',')) return fail("Expected ','");
+    skipSpace();
+    if (m_rowLengths.size() >= kMaxSide) return fail("Too many rows");
+    if (!consume('[')) {
+      // not a v1.0 row, stop right here instead of scanning the rest
+      m_unknownLayout = true;
+      return false;
+    }
+    skipSpace();
+    int length = 0;
+    while (!consume(']')) {
+      if (length > 0 && !consume(',')) return fail("Expected ','");
+      skipSpace();
+      if (length >= kMaxSide) return fail("Row is too long");
+      if (!parseCell()) return false;
+      ++length;
+      skipSpace();
+    }
+    m_rowLengths.append(length);
+    skipSpace();
+  }
+  return true;
+}
+
+bool ProjectParser::parseCell() {
+  if (!consume('{')) {
+    m_unknownLayout = true;
+    return false;
+  }
+  skipSpace();
+  int color = 0;
+  int depth = 0;
+  QByteArray key, name;
+  bool first = true;
+  while (!consume('}')) {
+    if (!first && !consume(',')) return fail("Expected ','");
+    first = false;
+    skipSpace();
+    if (!parseString(key)) return false;
+    skipSpace();
+    if (!consume(':')) return fail("Expected ':'");
+    skipSpace();
+    if (key == "color" && m_pos < m_end && *m_pos == '"') {
+      if (!parseString(name)) return false;
+      color = internColor(name);
+      if (color < 0) return false;
+    } else if (key == "depth") {
+      if (!parseInt(depth)) return false;
+    } else if (!skipValue()) {  // a null color, the shape and unknown keys
+      return false;
+    }
+    skipSpace();
+  }
+  m_colors.append(char(color));
+  m_depths.append(char(color ? qBound(1, depth, 255) : 0));
+  return true;
+}
+
+int ProjectParser::internColor(const QByteArray &name) {
+  auto known = m_colorIds.constFind(name);
+  if (known != m_colorIds.constEnd()) return known.value();
+
+  QColor color(QString::fromUtf8(name));
+  if (!color.isValid()) {
+    fail("Invalid cell color");
+    return -1;
+  }
+  // different names of the same color share an id
+  int id = m_cellColors.indexOf(color.rgba()) + 1;
+  if (id == 0) {
+    if (m_cellColors.size() >= PixelGrid::kMaxPaletteSize) {
+      fail("Too many colors");
+      return -1;
+    }
+    m_cellColors.append(color.rgba());
+    id = m_cellColors.size();
+  }
+  m_colorIds.insert(name, id);
+  return id;
+}
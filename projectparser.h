@@ -0,0 +1,61 @@
+#ifndef PROJECTPARSER_H
+#define PROJECTPARSER_H
+
+#include <QColor>
+#include <QtCore>
+
+class PixelGrid;
+
+/* ProjectParser reads version 1.0 JSON projects straight into a PixelGrid.
+ *
+ * Unlike QJsonDocument it builds no document tree. The bytes are scanned
+ * once, every cell is checked and stored into byte planes as soon as it is
+ * read, and each distinct color name is turned into a palette index only
+ * the first time it shows up. Keys may come in any order, so the planes
+ * are laid out once the whole document is known.
+ *
+ * Documents of other versions are reported as Unsupported, callers fall
+ * back to the generic JSON path for them. That is decided as soon as the
+ * version or the first cell that isn't a v1.0 cell object is read, so
+ * those documents aren't scanned twice.
+ */
+class ProjectParser {
+ public:
+  enum Result { Parsed, Unsupported, Invalid };
+
+  explicit ProjectParser(const QByteArray &data);
+
+  Result parse(PixelGrid &grid, QString *error = nullptr);
+
+ private:
+  bool fail(const char *message);
+  void skipSpace();
+  bool consume(char c);
+  bool parseString(QByteArray &value);
+  bool parseNumber(double &value);
+  bool parseInt(int &value);
+  bool skipValue(int level = 0);
+  bool parsePalette();
+  bool parsePixels();
+  bool parseCell();
+  int internColor(const QByteArray &name);
+
+  const char *m_begin;
+  const char *m_pos;
+  const char *m_end;
+  QString m_error;
+
+  QByteArray m_version;
+  int m_width = 0;
+  int m_height = 0;
+  QVector<QColor> m_palette;
+  // cells as read, colors are ids into m_cellColors plus one, 0 is empty
+  QByteArray m_colors;
+  QByteArray m_depths;
+  QVector<int> m_rowLengths;
+  bool m_unknownLayout = false;  // pixels are not rows of cell objects
+  QVector<QRgb> m_cellColors;
+  QHash<QByteArray, int> m_colorIds;
+};
+
+#endif  // PROJECTPARSER_H
@@ -0,0 +1,90 @@
+#include "shapelibrary.h"
+
+#include "gltfbuffer.h"
+
+ShapeLibrary &ShapeLibrary::instance() {
+  static ShapeLibrary library;
+  return library;
+}
+
+bool ShapeLibrary::appendShapes(const QVector<QString> &shapes,
+                                GLTFBuffer &buffer,
+                                QVector<Primitive> &primitives) {
+  primitives.clear();
+  for (const QString &name : shapes) {
+    Shape shapeDef;
+    if (!shape(name, shapeDef)) return false;
+
+    int accessorBase = buffer.appendBuffer(shapeDef.data, shapeDef.bufferViews,
+                                           shapeDef.accessors);
+    primitives.append(Primitive{accessorBase + shapeDef.primitive.position,
+                                accessorBase + shapeDef.primitive.normal,
+                                accessorBase + shapeDef.primitive.indices});
+  }
+  return true;
+}
+
+bool ShapeLibrary::shape(const QString &name, Shape &shape) {
+  // shapes are implicitly shared, handing out copies keeps callers lock free
+  QMutexLocker locker(&m_mutex);
+  auto cached = m_shapes.constFind(name);
+  if (cached != m_shapes.constEnd()) {
+    shape = cached.value();
+    return true;
+  }
+  if (!parseShape(name, shape)) return false;
+  m_shapes.insert(name, shape);
+  return true;
+}
+
+bool ShapeLibrary::parseShape(const QString &name, Shape &shape) {
+  QFile shapeFile(":/ui/exports/" + name + ".gltf");
+  if (!shapeFile.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QJsonObject shapeDef = QJsonDocument::fromJson(shapeFile.readAll()).object();
+  shapeFile.close();
+
+  /* all embedded buffers are decoded and concatenated, the bufferViews are
+   * moved onto that single buffer
+   */
+  QVector<int> bufferOffsets;
+  for (const QJsonValue &value : shapeDef.value("buffers").toArray()) {
+    QString uri = value.toObject().value("uri").toString();
+    QLatin1String prefix(GLTFBuffer::kDataUriPrefix);
+    if (!uri.startsWith(prefix)) return false;
+    while (shape.data.size() % 4) shape.data.append('\0');
+    bufferOffsets.append(shape.data.size());
+    shape.data.append(
+        QByteArray::fromBase64(uri.mid(prefix.size()).toLatin1()));
+  }
+
+  for (const QJsonValue &value : shapeDef.value("bufferViews").toArray()) {
+    QJsonObject view = value.toObject();
+    int bufferIndex = view.value("buffer").toInt();
+    if (bufferIndex < 0 || bufferIndex >= bufferOffsets.size()) return false;
+    view.insert("buffer", 0);
+    view.insert("byteOffset", view.value("byteOffset").toInt() +
+                                  bufferOffsets[bufferIndex]);
+    shape.bufferViews.append(view);
+  }
+  shape.accessors = shapeDef.value("accessors").toArray();
+
+  QJsonObject primitive = shapeDef.value("meshes")
+                              .toArray()
+                              .at(0)
+                              .toObject()
+                              .value("primitives")
+                              .toArray()
+                              .at(0)
+                              .toObject();
+  QJsonObject attributes = primitive.value("attributes").toObject();
+  if (!attributes.contains("POSITION") || !attributes.contains("NORMAL") ||
+      !primitive.contains("indices")) {
+    return false;
+  }
+  shape.primitive = Primitive{attributes.value("POSITION").toInt(),
+                              attributes.value("NORMAL").toInt(),
+                              primitive.value("indices").toInt()};
+  return true;
+}
@@ -0,0 +1,50 @@
+#ifndef SHAPELIBRARY_H
+#define SHAPELIBRARY_H
+
+#include <QtCore>
+
+class GLTFBuffer;
+
+/* ShapeLibrary parses the shape files under :/ui/exports once per process
+ * and keeps their geometry with all buffers decoded into one binary blob,
+ * so exports only have to copy bytes and rebase indices.
+ *
+ * It is safe to use from several threads at the same time.
+ */
+class ShapeLibrary {
+ public:
+  // accessor indices of the first primitive of a shape's first mesh
+  struct Primitive {
+    int position;
+    int normal;
+    int indices;
+  };
+
+  static ShapeLibrary &instance();
+
+  /* appends the geometry of all given shapes to buffer and fills primitives
+   * with their accessor indices rebased onto that buffer, in the same order
+   * as shapes. returns false if a shape can't be found or parsed
+   */
+  bool appendShapes(const QVector<QString> &shapes, GLTFBuffer &buffer,
+                    QVector<Primitive> &primitives);
+
+ private:
+  struct Shape {
+    QByteArray data;
+    QJsonArray bufferViews;
+    QJsonArray accessors;
+    Primitive primitive;
+  };
+
+  ShapeLibrary() = default;
+  Q_DISABLE_COPY(ShapeLibrary)
+
+  bool shape(const QString &name, Shape &shape);
+  static bool parseShape(const QString &name, Shape &shape);
+
+  QMutex m_mutex;
+  QHash<QString, Shape> m_shapes;
+};
+
+#endif  // SHAPELIBRARY_H
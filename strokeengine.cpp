@@ -0,0 +1,104 @@
+#include "strokeengine.h"
+
+namespace {
+// one batch per displayed frame at 60 Hz
+const int kFrameInterval = 16;
+}  // namespace
+
+StrokeEngine::StrokeEngine(QObject *parent) : QObject(parent) {
+  m_frameTimer.setSingleShot(true);
+  m_frameTimer.setInterval(kFrameInterval);
+  connect(&m_frameTimer, &QTimer::timeout, this, &StrokeEngine::flush);
+}
+
+StrokeEngine::~StrokeEngine() {}
+
+void StrokeEngine::begin(int row, int col, Tool tool, const QColor &color) {
+  if (m_active) end();
+  if (!m_grid) return;
+
+  m_colorIndex = tool == Paint ? m_grid->paletteIndex(color) : -1;
+  if (tool == Paint && m_colorIndex < 0) return;
+
+  m_active = true;
+  m_last = QPoint(col, row);
+  m_pending.clear();
+  emit strokeStarted();
+  emit activeChanged(true);
+
+  // the first cell is applied right away so a click feels immediate
+  QVector<int> cells;
+  rasterize(m_last, m_last, false, cells);
+  if (!cells.isEmpty()) m_grid->paintCells(cells, m_colorIndex);
+}
+
+void StrokeEngine::moveTo(int row, int col) {
+  if (!m_active) return;
+
+  QPoint position(col, row);
+  QPoint previous = m_pending.isEmpty() ? m_last : m_pending.last();
+  if (position == previous) return;
+  m_pending.append(position);
+  if (!m_frameTimer.isActive()) m_frameTimer.start();
+}
+
+void StrokeEngine::end() {
+  if (!m_active) return;
+
+  m_frameTimer.stop();
+  flush();
+  m_active = false;
+  emit activeChanged(false);
+  emit strokeFinished();
+}
+
+PixelGrid *StrokeEngine::grid() const { return m_grid; }
+
+bool StrokeEngine::active() const { return m_active; }
+
+void StrokeEngine::setGrid(PixelGrid *grid) {
+  if (m_grid == grid) return;
+
+  end();
+  m_grid = grid;
+  emit gridChanged(grid);
+}
+
+void StrokeEngine::flush() {
+  if (!m_grid) return;
+
+  QVector<int> cells;
+  for (const QPoint &position : m_pending) {
+    // the start of a segment is the end of the previous one
+    rasterize(m_last, position, true, cells);
+    m_last = position;
+  }
+  m_pending.clear();
+  if (!cells.isEmpty()) m_grid->paintCells(cells, m_colorIndex);
+}
+
+void StrokeEngine::rasterize(const QPoint &from, const QPoint &to,
+                             bool skipFirst, QVector<int> &cells) const {
+  int width = m_grid->width();
+  int height = m_grid->height();
+  int x = from.x(), y = from.y();
+  int dx = qAbs(to.x() - x), dy = -qAbs(to.y() - y);
+  int stepX = x < to.x() ? 1 : -1, stepY = y < to.y() ? 1 : -1;
+  int error = dx + dy;
+  bool first = true;
+  while (true) {
+    bool inside = x >= 0 && x < width && y >= 0 && y < height;
+    if (inside && !(first && skipFirst)) cells.append(y * width + x);
+    first = false;
+    if (x == to.x() && y == to.y()) break;
+    int error2 = 2 * error;
+    if (error2 >= dy) {
+      error += dy;
+      x += stepX;
+    }
+    if (error2 <= dx) {
+      error += dx;
+      y += stepY;
+    }
+  }
+}
@@ -0,0 +1,65 @@
+#ifndef STROKEENGINE_H
+#define STROKEENGINE_H
+
+#include <QColor>
+#include <QPointer>
+#include <QTimer>
+#include <QtCore>
+
+#include "pixelgrid.h"
+
+/* StrokeEngine turns pointer positions into grid edits. Every position is
+ * queued and once per frame the segments between consecutive positions
+ * are rasterized with Bresenham's algorithm and applied to the grid as one
+ * batch, so fast strokes have no gaps and cause one notification per frame
+ * no matter how often the pointer reports.
+ *
+ * Positions are cell coordinates and may lie outside the grid, segments
+ * are clipped cell by cell.
+ */
+class StrokeEngine : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(StrokeEngine)
+  Q_PROPERTY(PixelGrid *grid READ grid WRITE setGrid NOTIFY gridChanged)
+  Q_PROPERTY(bool active READ active NOTIFY activeChanged)
+
+ public:
+  enum Tool { Paint, Erase };
+  Q_ENUM(Tool)
+
+  StrokeEngine(QObject *parent = 0);
+  ~StrokeEngine();
+
+  Q_INVOKABLE void begin(int row, int col, Tool tool,
+                         const QColor &color = QColor());
+  Q_INVOKABLE void moveTo(int row, int col);
+  Q_INVOKABLE void end();
+
+  PixelGrid *grid() const;
+  bool active() const;
+
+ public slots:
+  void setGrid(PixelGrid *grid);
+
+ signals:
+  void gridChanged(PixelGrid *grid);
+  void activeChanged(bool active);
+  void strokeStarted();
+  void strokeFinished();
+
+ private slots:
+  void flush();
+
+ private:
+  void rasterize(const QPoint &from, const QPoint &to, bool skipFirst,
+                 QVector<int> &cells) const;
+
+  QPointer<PixelGrid> m_grid;
+  QTimer m_frameTimer;
+  bool m_active = false;
+  int m_colorIndex = -1;  // -1 erases
+  QPoint m_last;          // x is the column, y the row
+  QVector<QPoint> m_pending;
+};
+
+#endif  // STROKEENGINE_H
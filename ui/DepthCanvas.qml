@@ -2,6 +2,7 @@ import QtQuick 2.15
 import PixelModelMaker 1.0
 import QtQuick.Controls 2.15
 import QtQuick.Controls.Material 2.15
+import com.github.zaghaghi.pixelmodelmaker 1.0
 
 Pane {
     padding: 10
@@ -17,39 +18,13 @@ Pane {
 
     Item {
         anchors.fill: parent
-        Canvas {
+        DepthView {
             id: depthCanvas
             anchors.fill: parent
-            onPaint: {
-                var ctx = getContext("2d")
-                ctx.font = "bold normal 10px Roboto"
-                const black = Constants.checkerBoardBlack
-                const white = Constants.checkerBoardWhite
-                const cellSize = width / GlobalState.gridWidth
-                for (var i = 0; i < GlobalState.gridHeight; ++i) {
-                    for (var j = 0; j < GlobalState.gridWidth; ++j) {
-                        ctx.fillStyle = (i + j) % 2 ? black : white
-                        ctx.fillRect(i * cellSize, j * cellSize,
-                                     cellSize, cellSize)
-                        let pixel = GlobalState.pixelMap[j][i]
-                        if (pixel.color) {
-                            const fillColor = pixel.color
-                            ctx.fillStyle = Qt.rgba(fillColor.r, fillColor.g,
-                                                    fillColor.b, 0.6)
-                            ctx.fillRect(i * cellSize, j * cellSize,
-                                         cellSize, cellSize)
-                        }
-                        if (pixel.depth) {
-                            ctx.fillStyle = Qt.rgba(0, 0, 0, 1)
-                            ctx.textAlign = "center"
-                            ctx.textBaseline = "middle"
-                            ctx.fillText(pixel.depth,
-                                         i * cellSize + cellSize / 2,
-                                         j * cellSize + cellSize / 2)
-                        }
-                    }
-                }
-            }
+            grid: GlobalState.grid
+            maxDepth: Constants.maxDepthValue
+            checkerColor: Constants.checkerBoardWhite
+            alternateCheckerColor: Constants.checkerBoardBlack
         }
 
         MouseArea {
@@ -67,19 +42,19 @@ Pane {
             if (col >= GlobalState.gridWidth || col < 0
                     || row >= GlobalState.gridHeight || row < 0)
                 return
-            let pixel = GlobalState.pixelMap[row][col]
-            if (pixel.color === null || pixel.depth === 0)
+            if (GlobalState.grid.isEmpty(row, col))
                 return
+            const depth = GlobalState.grid.depth(row, col)
             if (mouse.button === Qt.LeftButton) {
-                pixel.depth = Math.min(Constants.maxDepthValue, pixel.depth + 1)
+                GlobalState.grid.setDepth(row, col,
+                                          Math.min(Constants.maxDepthValue, depth + 1))
             } else {
-                pixel.depth = Math.max(1, pixel.depth - 1)
+                GlobalState.grid.setDepth(row, col, Math.max(1, depth - 1))
             }
-            depthCanvas.requestPaint()
         }
     }
 
     function repaint() {
-        depthCanvas.requestPaint()
+        depthCanvas.update()
     }
 }
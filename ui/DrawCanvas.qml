@@ -2,6 +2,7 @@ import QtQuick 2.15
 import PixelModelMaker 1.0
 import QtQuick.Controls 2.15
 import QtQuick.Controls.Material 2.15
+import com.github.zaghaghi.pixelmodelmaker 1.0
 
 Pane {
     id: drawPane
@@ -18,94 +19,56 @@ Pane {
 
     Item {
         anchors.fill: parent
-        Canvas {
+        PixelCanvas {
             id: canvas
             anchors.fill: parent
-            onPaint: {
-                var ctx = getContext("2d")
-                const black = Constants.checkerBoardBlack
-                const white = Constants.checkerBoardWhite
-                const cellSize = width / GlobalState.gridWidth
-                for (var i = 0; i < GlobalState.gridHeight; ++i) {
-                    for (var j = 0; j < GlobalState.gridWidth; ++j) {
-                        let fillColor = (i + j) % 2 ? black : white
-                        if (GlobalState.pixelMap && GlobalState.pixelMap[j][i]
-                                && GlobalState.pixelMap[j][i].color) {
-                            fillColor = GlobalState.pixelMap[j][i].color
-                        }
-                        ctx.fillStyle = fillColor
-                        ctx.fillRect(i * cellSize, j * cellSize,
-                                     cellSize, cellSize)
-                    }
-                }
-            }
+            grid: GlobalState.grid
+            checkerColor: Constants.checkerBoardWhite
+            alternateCheckerColor: Constants.checkerBoardBlack
+        }
+
+        StrokeEngine {
+            id: stroke
+            grid: GlobalState.grid
+            onStrokeStarted: GlobalState.history.beginStroke()
+            onStrokeFinished: GlobalState.history.endStroke()
         }
 
         MouseArea {
             width: parent.width
             height: parent.height
             acceptedButtons: Qt.AllButtons
-            hoverEnabled: true
 
-            onClicked: parent.handleClick(mouse)
+            onPressed: parent.handlePress(mouse)
             onPositionChanged: parent.handleDrag(mouse)
+            onReleased: stroke.end()
+            onCanceled: stroke.end()
         }
 
-        function destroyPixel(pixel) {
-            pixel.color = null
-            pixel.depth = 0
-            if (pixel.shape) {
-                pixel.shape.destroy()
-                pixel.shape = null
-            }
-            if (pixel.miniShape) {
-                pixel.miniShape.destroy()
-                pixel.miniShape = null
-            }
+        // cells are not clamped, the stroke engine clips segments leaving the grid
+        function cellAt(mouse) {
+            const cellSize = width / GlobalState.gridWidth
+            return Qt.point(Math.floor(mouse.x / cellSize),
+                            Math.floor(mouse.y / cellSize))
         }
 
-        function handleClick(mouse) {
-            const cellSize = width / GlobalState.gridWidth
-            const col = parseInt(mouse.x / cellSize)
-            const row = parseInt(mouse.y / cellSize)
-            if (col >= GlobalState.gridWidth || col < 0
-                    || row >= GlobalState.gridHeight || row < 0)
-                return
-            let pixel = GlobalState.pixelMap[row][col]
+        function handlePress(mouse) {
+            const cell = cellAt(mouse)
             if (mouse.button === Qt.LeftButton) {
-                let color = GlobalState.selectedColor
-                pixel.color = Qt.rgba(color.r, color.g, color.b, color.a)
-                if (pixel.depth === 0)
-                    pixel.depth = 1
+                stroke.begin(cell.y, cell.x, StrokeEngine.Paint,
+                             GlobalState.selectedColor)
             } else {
-                destroyPixel(pixel)
+                stroke.begin(cell.y, cell.x, StrokeEngine.Erase)
             }
-            canvas.requestPaint()
         }
 
         function handleDrag(mouse) {
-            const cellSize = width / GlobalState.gridWidth
-            const col = parseInt(mouse.x / cellSize)
-            const row = parseInt(mouse.y / cellSize)
-            if (col >= GlobalState.gridWidth || col < 0
-                    || row >= GlobalState.gridHeight || row < 0)
-                return
-            let pixel = GlobalState.pixelMap[row][col]
-            if (mouse.buttons === Qt.LeftButton
-                    && pixel.color !== GlobalState.selectedColor) {
-                let color = GlobalState.selectedColor
-                pixel.color = Qt.rgba(color.r, color.g, color.b, color.a)
-                if (pixel.depth === 0)
-                    pixel.depth = 1
-                canvas.requestPaint()
-            } else if (mouse.buttons === Qt.RightButton) {
-                destroyPixel(pixel)
-                canvas.requestPaint()
-            }
+            const cell = cellAt(mouse)
+            stroke.moveTo(cell.y, cell.x)
         }
     }
 
     function repaint() {
-        canvas.requestPaint()
+        canvas.update()
     }
 }
@@ -1,8 +1,29 @@
 import QtQuick 2.15
+import QtQuick.Controls 2.15
+import PixelModelMaker 1.0
 
 Item {
-    Text {
-        text: qsTr("Export Model")
+    Column {
+        anchors.centerIn: parent
+        spacing: 10
+
+        Text {
+            text: qsTr("Export Model")
+            color: Constants.titleColor
+            font.family: "Roboto"
+            font.styleName: "Medium"
+            font.pixelSize: 18
+        }
+
+        // entries follow the order of GltfExport.Mode
+        ComboBox {
+            id: exportModeSelector
+            width: 250
+            model: [qsTr("One node per pixel"), qsTr("Merged meshes"),
+                qsTr("Optimized meshes"), qsTr("GPU instancing")]
+            currentIndex: GlobalState.exportMode
+            onActivated: GlobalState.exportMode = currentIndex
+        }
     }
     width: 1920
     height: 1080
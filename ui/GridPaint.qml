@@ -16,6 +16,13 @@ Item {
     property alias backButton: backButton
     property int viewMode: 0
     property variant viewNames: ["Edit Mode", "Depth Mode", "View Mode", "Export"]
+    // the journal revision the running save was started at
+    property int savedRevision: 0
+
+    function saveProject() {
+        savedRevision = GlobalState.journal.revision()
+        io.writeProjectAsync(GlobalState.grid)
+    }
 
     width: 1000
     height: 600
@@ -63,7 +70,7 @@ Item {
                         if (io.source !== GlobalState.fileName) {
                             io.source = GlobalState.fileName
                         } else {
-                            io.text = GlobalState.getSaveString()
+                            saveProject()
                         }
                     }
 
@@ -81,6 +88,18 @@ Item {
                     exportImageDialog.open()
                 }
             }
+            ProgressBar {
+                id: exportProgress
+                anchors.verticalCenter: parent.verticalCenter
+                visible: exporter.busy
+                value: exporter.progressValue
+            }
+            ToolButton {
+                id: cancelExport
+                text: qsTr("Cancel")
+                visible: exporter.busy
+                onClicked: exporter.cancel()
+            }
             ToolButton {
                 id: export3d
 
@@ -133,6 +152,11 @@ Item {
             }
         }
 
+        // rendered by both the main and the mini view
+        VoxelScene {
+            id: sharedScene
+        }
+
         Item {
             id: viewComponents
             visible: viewMode == 2
@@ -141,6 +165,7 @@ Item {
             ViewModel {
                 id: view
                 anchors.fill: parent
+                voxelScene: sharedScene
             }
         }
 
@@ -160,6 +185,7 @@ Item {
             anchors.fill: parent
             MiniViewModel {
                 id: miniView
+                voxelScene: sharedScene
                 width: 250
                 height: 250
                 anchors.left: parent.left
@@ -251,6 +277,18 @@ Item {
         }
     }
 
+    Shortcut {
+        sequence: StandardKey.Undo
+        enabled: GlobalState.history.canUndo
+        onActivated: GlobalState.history.undo()
+    }
+
+    Shortcut {
+        sequence: StandardKey.Redo
+        enabled: GlobalState.history.canRedo
+        onActivated: GlobalState.history.redo()
+    }
+
     FileIO {
         id: io
         source: saveFileDialog.file
@@ -258,20 +296,27 @@ Item {
         onSourceChanged: {
              if (`${io.source}` === `.${saveFileDialog.defaultSuffix}`) return
              GlobalState.fileName = io.source
-             io.text = GlobalState.getSaveString()
+             if (saveFileDialog.selectedNameFilter.index === 1)
+                 GlobalState.grid.jsonVersion = "1.1"
+             else if (saveFileDialog.selectedNameFilter.index === 0)
+                 GlobalState.grid.jsonVersion = "1.0"
+             GlobalState.journal.open(io.source, false)
+             saveProject()
         }
 
-        onTextChanged: {
-           io.write()
-       }
+        onWriteFinished: GlobalState.journal.markSaved(savedRevision)
+
+        onFailed: (source, message) => console.log(`Can't save ${source}: ${message}`)
     }
 
     FileDialog {
         id: saveFileDialog
         folder: StandardPaths.writableLocation(StandardPaths.DocumentsLocation)
         fileMode: FileDialog.SaveFile
-        defaultSuffix: "json"
-        nameFilters: ["JSON Files (*.json)"]
+        defaultSuffix: selectedNameFilter.extensions[0]
+        // compact JSON is the 1.1 layout, which older versions can't open
+        nameFilters: ["JSON Files (*.json)", "Compact JSON Files (*.json)",
+                      "Pixel Model Maker Project (*.pmm)"]
 
     }
 
@@ -317,11 +362,28 @@ Item {
 
     GltfExport {
         id: exporter
+        mode: GlobalState.exportMode
+        // all stages weigh the same
+        property real progressValue: 0
+
+        onBusyChanged: progressValue = 0
+
+        onProgress: (fileName, stage, done, total) => {
+            progressValue = (stage + done / total) / 3
+        }
 
         onExported: {
             exportModelInfoDialog.open()
         }
 
+        onOptimized: (fileName, verticesBefore, trianglesBefore,
+                      verticesAfter, trianglesAfter) => {
+            exportModelInfoDialog.statistics =
+                    qsTr("%1 → %2 vertices, %3 → %4 triangles")
+                    .arg(verticesBefore).arg(verticesAfter)
+                    .arg(trianglesBefore).arg(trianglesAfter)
+        }
+
         onError: (fileName, errorMsg) => {
             exportModelErrorDialog.open()
         }
@@ -331,13 +393,14 @@ Item {
         id: exportModelDialog
         folder: StandardPaths.writableLocation(StandardPaths.DocumentsLocation)
         fileMode: FileDialog.SaveFile
-        defaultSuffix: "gltf"
-        nameFilters:["glTF 2.0 (*.gltf)"]
+        defaultSuffix: selectedNameFilter.extensions[0]
+        nameFilters:["glTF 2.0 (*.gltf)", "glTF 2.0 Binary (*.glb)"]
 
         onFileChanged: {
             let exportFileName = exportModelDialog.file.toString()
 
             if (exportFileName === "") return
+            exportModelInfoDialog.statistics = ""
             exporter.write(exportFileName, GlobalState.getSaveObject())
         }
     }
@@ -356,11 +419,13 @@ Item {
 
     Dialog {
         id: exportModelInfoDialog
+        property string statistics: ""
         modal: true
         standardButtons: Dialog.Ok
         title: qsTr("Model Exported")
         Label {
-                text: "Model exported successfully"
+                text: "Model exported successfully" + (exportModelInfoDialog.statistics
+                                                       ? "\n" + exportModelInfoDialog.statistics : "")
         }
         x: (parent.width - width) / 2
         y: (parent.height - height) / 2
@@ -9,6 +9,7 @@ import QtQuick.Controls 2.15
 
 Pane {
     id: palettePane
+    property alias voxelScene: root.voxelScene
     z: 1
     padding: 10
     background: Rectangle {
@@ -23,7 +24,8 @@ Pane {
     Item {
         id: root
         property alias sceneView: sceneView
-        property alias gridModelContainer: gridModelContainer
+        property alias cameraRig: cameraRig
+        property Node voxelScene
         width: 230
         height: 230
 
@@ -33,8 +35,31 @@ Pane {
             camera: perspCamera
             environment: environment
 
+            importScene: root.voxelScene
+
+            // orbits around the shared scene, see ViewModel.qml
             Node {
-                id: scene
+                id: cameraRig
+
+                SequentialAnimation {
+                    running: true
+                    loops: Animation.Infinite
+                    NumberAnimation {
+                        target: cameraRig
+                        property: "eulerRotation.y"
+                        duration: 5000
+                        from: -45
+                        to: 45
+                    }
+                    NumberAnimation {
+                        target: cameraRig
+                        property: "eulerRotation.y"
+                        duration: 5000
+                        from: 45
+                        to: -45
+                    }
+                }
+
                 OrthographicCamera {
                     id: orthoCamera
                     x: 0
@@ -49,89 +74,6 @@ Pane {
                     z: 1600
                 }
 
-                Node {
-                    id: gridModelContainer
-
-                    SequentialAnimation {
-                        running: true
-                        loops: Animation.Infinite
-                        NumberAnimation {
-                            target: gridModelContainer
-                            property: "eulerRotation.y"
-                            duration: 5000
-                            from: 45
-                            to: -45
-                        }
-                        NumberAnimation {
-                            target: gridModelContainer
-                            property: "eulerRotation.y"
-                            duration: 5000
-                            from: -45
-                            to: 45
-                        }
-                    }
-
-                    Timer {
-                        interval: 1000
-                        repeat: true
-                        running: true
-                        onTriggered: updateViewModel()
-
-                        function updateViewModel() {
-                            gridModelContainer.updateShapes()
-                        }
-                    }
-
-                    function createShape(row, col, parent) {
-                        const scale = 50
-                        const xOffset = GlobalState.gridWidth / 2 * scale
-                        const yOffset = GlobalState.gridHeight / 2 * scale
-                        let pixel = GlobalState.pixelMap[row][col]
-                        let color = pixel.color
-                        let colorVector = Qt.vector3d(color.r, color.g, color.b)
-
-                        var cubeComponent = Qt.createComponent(
-                                    "qrc:/ui/shapes/Cube.qml")
-
-                        let instance = cubeComponent.createObject(parent, {
-                                                                      "x": -xOffset + col * scale,
-                                                                      "y": yOffset - row * scale,
-                                                                      "z": 0,
-                                                                      "shapeColor": colorVector,
-                                                                      "depth": pixel.depth
-                                                                  })
-                        return instance
-                    }
-
-                    function updateShape(row, col) {
-                        let pixel = GlobalState.pixelMap[row][col]
-                        let color = pixel.color
-                        let colorVector = Qt.vector3d(color.r, color.g, color.b)
-
-                        if (pixel.miniShape === null) {
-                            pixel.miniShape = createShape(row, col,
-                                                          gridModelContainer)
-                        } else {
-                            if (pixel.miniShape.shapeColor !== colorVector) {
-                                pixel.miniShape.shapeColor = colorVector
-                            }
-                            if (pixel.depth !== pixel.miniShape.depth) {
-                                pixel.miniShape.depth = pixel.depth
-                            }
-                        }
-                    }
-
-                    function updateShapes() {
-                        for (var i = 0; i < GlobalState.gridWidth; ++i) {
-                            for (var j = 0; j < GlobalState.gridHeight; ++j) {
-                                if (GlobalState.pixelMap[i][j].color) {
-                                    updateShape(i, j)
-                                }
-                            }
-                        }
-                    }
-                }
-
                 PointLight {
                     id: mainLight
                     x: 0
@@ -2,6 +2,7 @@ import QtQuick 2.15
 import PixelModelMaker 1.0
 import QtQuick.Controls.Material 2.15
 import QtQuick.Controls 2.15
+import QtQuick.Window 2.15
 
 
 Pane {
@@ -10,6 +11,13 @@ Pane {
     height: Constants.height
     Material.theme: Material.Dark
 
+    // grid edits reach the views once per frame of this window
+    Binding {
+        target: GlobalState.grid
+        property: "window"
+        value: Window.window
+    }
+
     StackView {
         id: stackView
         initialItem: sizeSelector
@@ -33,8 +41,7 @@ Pane {
         }
 
         function createGridPaint(size) {
-            GlobalState.destroyPixelMap()
-            GlobalState.createPixelMap(size, size)
+            GlobalState.createGrid(size, size)
             pushGridPaint()
         }
 
@@ -50,6 +57,7 @@ Pane {
         width: parent.width
         height: parent.height
         backButton.onClicked: {
+            GlobalState.journal.close()
             GlobalState.fileName = ""
             stackView.pop(StackView.Immediate)
         }
@@ -21,6 +21,26 @@ Rectangle {
 
     property bool fileOpnedWithSuccess: false
 
+    // unsaved edits of earlier sessions, offered one after the other on start
+    property var pendingJournals: []
+
+    Component.onCompleted: {
+        pendingJournals = GlobalState.journal.pendingJournals()
+        offerNextJournal()
+    }
+
+    function offerNextJournal() {
+        if (pendingJournals.length === 0) return
+        const pending = pendingJournals[0]
+        recoverDialog.journal = pending.journal
+        recoverDialog.project = `${pending.project}`
+        recoverDialog.open()
+    }
+
+    function takeJournal() {
+        pendingJournals = pendingJournals.slice(1)
+    }
+
     Item {
         id: row1
         x: 0
@@ -109,6 +129,7 @@ Rectangle {
                 onClicked: {
                     fileOpnedWithSuccess = false
                     openFileDialog.file = ""
+                    io.cancel()
                     io.reset()
                     openFileDialog.open()
                 }
@@ -120,17 +141,17 @@ Rectangle {
         source: openFileDialog.file
 
         onSourceChanged: {
-            io.read()
+            if (`${io.source}` === "") return
+            io.readProjectAsync(GlobalState.grid)
         }
 
-        onTextChanged: {
-           if (!GlobalState.setOpenString(io.text, io.source)) {
-               // TODO: show a dialog to inform the user file is not supported
-               errorDialog.open()
-               return
-           }
-           fileOpnedWithSuccess = true
-       }
+        onReadFinished: (source) => {
+            console.log(`Opened ${source} in ${io.parseTime} ms`)
+            GlobalState.projectOpened(source)
+            fileOpnedWithSuccess = true
+        }
+
+        onFailed: errorDialog.open()
     }
 
     FileDialog {
@@ -138,7 +159,8 @@ Rectangle {
         folder: StandardPaths.writableLocation(StandardPaths.DocumentsLocation)
         fileMode: FileDialog.OpenFile
         defaultSuffix: "json"
-        nameFilters: ["JSON Files (*.json)"]
+        nameFilters: ["Pixel Model Maker Projects (*.json *.pmm)",
+            "JSON Files (*.json)", "Pixel Model Maker Project (*.pmm)"]
 
     }
     Dialog {
@@ -152,6 +174,37 @@ Rectangle {
         x: (parent.width - width) / 2
         y: (parent.height - height) / 2
     }
+    Dialog {
+        id: recoverDialog
+        property string journal: ""
+        property string project: ""
+        modal: true
+        standardButtons: Dialog.Yes | Dialog.No
+        title: qsTr("Recover Unsaved Changes")
+        Label {
+                text: recoverDialog.project === ""
+                      ? qsTr("An unsaved model was left from an earlier session, recover it?")
+                      : qsTr("%1 has unsaved changes from an earlier session, recover them?")
+                        .arg(recoverDialog.project)
+        }
+        x: (parent.width - width) / 2
+        y: (parent.height - height) / 2
+
+        onAccepted: {
+            takeJournal()
+            if (GlobalState.recoverJournal(journal)) {
+                fileOpnedWithSuccess = true
+            } else {
+                errorDialog.open()
+                offerNextJournal()
+            }
+        }
+        onRejected: {
+            takeJournal()
+            GlobalState.journal.discard(journal)
+            offerNextJournal()
+        }
+    }
 }
 
 /*##^##
@@ -1,4 +1,5 @@
 import QtQuick 2.15
+import QtQuick.Controls 2.15
 import QtQuick3D 1.15
 import QtQuick3D.Helpers 1.15
 import PixelModelMaker 1.0
@@ -6,7 +7,8 @@ import PixelModelMaker 1.0
 Item {
     id: root
     property alias sceneView: sceneView
-    property alias gridModelContainer: gridModelContainer
+    property alias cameraRig: cameraRig
+    property Node voxelScene
     width: 300
     height: 300
 
@@ -22,8 +24,13 @@ Item {
             aoSampleRate: 4
             aoStrength: 20
         }
+
+        importScene: root.voxelScene
+
+        // the scene is shared with the mini view, so instead of rotating the
+        // models this view orbits its camera and lights around the origin
         Node {
-            id: scene
+            id: cameraRig
             OrthographicCamera {
                 id: orthoCamera
                 x: 0
@@ -38,68 +45,6 @@ Item {
                 z: 1600
             }
 
-            Node {
-                id: gridModelContainer
-
-                Timer {
-                    interval: 1000
-                    repeat: true
-                    running: true
-                    onTriggered: updateViewModel()
-
-                    function updateViewModel() {
-                        gridModelContainer.updateShapes()
-                    }
-                }
-
-                function createShape(row, col, parent) {
-                    const scale = 50
-                    const xOffset = GlobalState.gridWidth / 2 * scale
-                    const yOffset = GlobalState.gridHeight / 2 * scale
-                    let pixel = GlobalState.pixelMap[row][col]
-                    let color = pixel.color
-                    let colorVector = Qt.vector3d(color.r, color.g, color.b)
-
-                    var cubeComponent = Qt.createComponent("qrc:/ui/shapes/Cube.qml")
-
-                    let instance = cubeComponent.createObject(parent, {
-                                                                  "x": -xOffset + col * scale,
-                                                                  "y": yOffset - row * scale,
-                                                                  "z": 0,
-                                                                  "shapeColor": colorVector,
-                                                                  "depth": pixel.depth
-                                                              })
-                    return instance
-                }
-
-                function updateShape(row, col) {
-                    let pixel = GlobalState.pixelMap[row][col]
-                    let color = pixel.color
-                    let colorVector = Qt.vector3d(color.r, color.g, color.b)
-
-                    if (pixel.shape === null) {
-                        pixel.shape = createShape(row, col, gridModelContainer)
-                    } else {
-                        if (pixel.shape.shapeColor !== colorVector) {
-                            pixel.shape.shapeColor = colorVector
-                        }
-                        if (pixel.depth !== pixel.shape.depth) {
-                            pixel.shape.depth = pixel.depth
-                        }
-                    }
-                }
-
-                function updateShapes() {
-                    for (var i = 0; i < GlobalState.gridWidth; ++i) {
-                        for (var j = 0; j < GlobalState.gridHeight; ++j) {
-                            if (GlobalState.pixelMap[i][j].color) {
-                                updateShape(i, j)
-                            }
-                        }
-                    }
-                }
-            }
-
             PointLight {
                 id: mainLight
                 x: 0
@@ -141,17 +86,25 @@ Item {
             if (event.buttons === Qt.LeftButton) {
                 const diffX = lastX - event.x
                 const diffY = lastY - event.y
-                gridModelContainer.eulerRotation.y = gridModelContainer.eulerRotation.y - diffX
-                gridModelContainer.eulerRotation.x = gridModelContainer.eulerRotation.x - diffY
+                cameraRig.eulerRotation.y = cameraRig.eulerRotation.y + diffX
+                cameraRig.eulerRotation.x = cameraRig.eulerRotation.x + diffY
                 lastX = event.x
                 lastY = event.y
             }
         }
     }
 
+    CheckBox {
+        anchors.top: parent.top
+        anchors.right: parent.right
+        text: qsTr("GPU instancing")
+        checked: GlobalState.instancedRendering
+        onToggled: GlobalState.instancedRendering = checked
+    }
+
     function resetRotation() {
-        gridModelContainer.eulerRotation.x = 0
-        gridModelContainer.eulerRotation.y = 0
-        gridModelContainer.eulerRotation.z = 0
+        cameraRig.eulerRotation.x = 0
+        cameraRig.eulerRotation.y = 0
+        cameraRig.eulerRotation.z = 0
     }
 }
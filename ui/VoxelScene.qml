@@ -0,0 +1,47 @@
+import QtQuick 2.15
+import QtQuick3D 1.15
+import PixelModelMaker 1.0
+import com.github.zaghaghi.pixelmodelmaker 1.0
+
+// Models for the painted grid. One instance is shared by every View3D through
+// importScene, each view brings its own camera and lights.
+Node {
+    id: voxelScene
+
+    // chunk edge length in cells, an edit only rebuilds the chunks it touches
+    property int chunkSize: 16
+    readonly property int chunkColumns: Math.ceil(GlobalState.gridWidth / chunkSize)
+    readonly property int chunkRows: Math.ceil(GlobalState.gridHeight / chunkSize)
+
+    // the grid as one mesh per chunk with per vertex colors, or one
+    // instanced cube per painted cell. the unused one is detached from
+    // the grid so it doesn't follow edits
+    Repeater3D {
+        model: GlobalState.instancedRendering ? 0 : chunkRows * chunkColumns
+        delegate: Model {
+            geometry: VoxelGeometry {
+                grid: GlobalState.grid
+                chunkSize: voxelScene.chunkSize
+                chunkRow: Math.floor(index / voxelScene.chunkColumns)
+                chunkCol: index % voxelScene.chunkColumns
+            }
+            materials: [
+                DefaultMaterial {
+                    vertexColorsEnabled: true
+                }
+            ]
+        }
+    }
+
+    Model {
+        visible: GlobalState.instancedRendering
+        source: "qrc:/ui/shapes/meshes/cube.mesh"
+        instancing: VoxelInstancing {
+            grid: GlobalState.instancedRendering ? GlobalState.grid : null
+        }
+        materials: [
+            // instance colors tint the default white diffuse color
+            DefaultMaterial {}
+        ]
+    }
+}
@@ -2,31 +2,38 @@ pragma Singleton
 
 import QtQuick 2.15
 import PixelModelMaker 1.0
+import com.github.zaghaghi.pixelmodelmaker 1.0
 
 QtObject {
-    property variant pixelMap: null
-    property int gridWidth: 0
-    property int gridHeight: 0
+    readonly property PixelGrid grid: PixelGrid {}
+    readonly property int gridWidth: grid.width
+    readonly property int gridHeight: grid.height
+
+    // undo and redo of strokes and depth edits on the grid
+    readonly property UndoHistory history: UndoHistory {
+        grid: GlobalState.grid
+    }
+
+    // journals every edit so a crash loses nothing, saved or not
+    readonly property AutosaveJournal journal: AutosaveJournal {
+        grid: GlobalState.grid
+        onRecovered: (project, records) =>
+                     console.log(`Recovered ${records} unsaved edits of ${project}`)
+        onFailed: (message) => console.log(`Autosave failed: ${message}`)
+    }
 
     property color selectedColor: Constants.defaultColorPalette[0]
 
     property string fileName: ''
 
+    property int exportMode: 0
+
+    // 3D views draw instanced cubes instead of one merged mesh
+    property bool instancedRendering: false
+
 
     function getSaveObject() {
-        return {
-                    version: "1.0",
-                    palette: Constants.defaultColorPalette,
-                    width: gridWidth,
-                    height: gridHeight,
-                    pixels: pixelMap.map((row) => row.map((item) => {
-                        return {
-                            "color": item.color?item.color.toString():null,
-                            "depth": item.depth,
-                            "shape": item.shape?item.shape.name:null
-                        }
-                    }))
-        }
+        return grid.jsonVersion === "1.1" ? grid.toCompactJson() : grid.toJson()
     }
 
     function getSaveString() {
@@ -34,69 +41,36 @@ QtObject {
     }
 
     function setOpenString(jsonData, fileName) {
-        try {
-            let data = JSON.parse(jsonData)
-            if (data.version !== "1.0") {
-                console.log("invalid version")
-                return false
-            }
-            destroyPixelMap()
-            gridWidth = data.width
-            gridHeight = data.height
-            Constants.defaultColorPalette = data.palette
-            selectedColor = Constants.defaultColorPalette[0]
-            pixelMap = data.pixels.map((row) => row.map((item) => {
-                return {
-                    "color": item.color?Qt.color(item.color):null,
-                    "depth": item.depth,
-                    "shape": null, // find and create shape based on item.shape which is shape name
-                    "miniShape": null,
-
-                }
-            }))
-            GlobalState.fileName = fileName
-        } catch (exception) {
-            console.log(exception)
+        if (!grid.loadJson(jsonData)) {
+            console.log("invalid file")
             return false
         }
+        projectOpened(fileName)
         return true
     }
 
-    function destroyPixelMap() {
-        if (pixelMap === null || gridHeight === 0 || gridWidth === 0) {
-            return
-        }
-        if (pixelMap !== null) {
-            for (var i = 0; i < gridHeight; ++i) {
-                for (var j = 0; j < gridWidth; ++j) {
-                    if (pixelMap[i][j].shape !== null) {
-                        pixelMap[i][j].shape.destroy()
-                        pixelMap[i][j].shape = null
-                    }
-                    if (pixelMap[i][j].miniShape !== null) {
-                        pixelMap[i][j].miniShape.destroy()
-                        pixelMap[i][j].miniShape = null
-                    }
-                }
-            }
-        }
+    // call after the grid was loaded from fileName
+    function projectOpened(fileName) {
+        journal.open(fileName, true)
+        Constants.defaultColorPalette = grid.palette
+        selectedColor = Constants.defaultColorPalette[0]
+        GlobalState.fileName = fileName
     }
 
-    function createPixelMap(width, height) {
-        gridWidth = width
-        gridHeight = height
-        pixelMap = []
-        for (var i = 0; i < gridHeight; ++i) {
-            let pixelRow = []
-            for (var j = 0; j < gridWidth; ++j) {
-                pixelRow.push({
-                                  "color": null,
-                                  "depth": 0,
-                                  "shape": null,
-                                  "miniShape": null,
-                              })
-            }
-            pixelMap.push(pixelRow)
-        }
+    // replays unsaved edits of an earlier session, see journal.pendingJournals
+    function recoverJournal(path) {
+        if (!journal.recover(path))
+            return false
+        Constants.defaultColorPalette = grid.palette
+        selectedColor = Constants.defaultColorPalette[0]
+        GlobalState.fileName = `${journal.project}`
+        return true
+    }
+
+    function createGrid(width, height) {
+        journal.close()
+        grid.palette = Constants.defaultColorPalette
+        grid.create(width, height)
+        journal.open("", true)
     }
 }
@@ -0,0 +1,181 @@
+#include "undohistory.h"
+
+namespace {
+quint16 packCell(quint8 color, quint8 depth) { return color << 8 | depth; }
+}  // namespace
+
+UndoHistory::UndoHistory(QObject *parent) : QObject(parent) {}
+
+UndoHistory::~UndoHistory() {}
+
+void UndoHistory::beginStroke() { ++m_strokeDepth; }
+
+void UndoHistory::endStroke() {
+  if (m_strokeDepth == 0) return;
+  if (m_grid) m_grid->flushDirtyCells();
+  if (--m_strokeDepth == 0) commitStep();
+}
+
+void UndoHistory::undo() {
+  if (!m_grid || m_strokeDepth > 0) return;
+
+  // edits still waiting for the next frame are a step of their own
+  m_grid->flushDirtyCells();
+  if (m_undo.isEmpty()) return;
+
+  Step step = m_undo.takeLast();
+  apply(step, false);
+  m_redo.append(std::move(step));
+  emit historyChanged();
+}
+
+void UndoHistory::redo() {
+  if (!m_grid || m_strokeDepth > 0) return;
+
+  m_grid->flushDirtyCells();
+  if (m_redo.isEmpty()) return;
+
+  Step step = m_redo.takeLast();
+  apply(step, true);
+  m_undo.append(std::move(step));
+  emit historyChanged();
+}
+
+void UndoHistory::clear() {
+  m_undo.clear();
+  m_redo.clear();
+  m_open.clear();
+  m_memoryUsage = 0;
+  emit historyChanged();
+}
+
+PixelGrid *UndoHistory::grid() const { return m_grid; }
+
+bool UndoHistory::canUndo() const { return !m_undo.isEmpty(); }
+
+bool UndoHistory::canRedo() const { return !m_redo.isEmpty(); }
+
+qint64 UndoHistory::memoryUsage() const { return m_memoryUsage; }
+
+qint64 UndoHistory::memoryBudget() const { return m_memoryBudget; }
+
+void UndoHistory::setGrid(PixelGrid *grid) {
+  if (m_grid == grid) return;
+
+  if (m_grid) disconnect(m_grid, nullptr, this, nullptr);
+  m_grid = grid;
+  if (m_grid) {
+    connect(m_grid, &PixelGrid::cellsChanged, this,
+            &UndoHistory::recordCells);
+    connect(m_grid, &PixelGrid::gridChanged, this, &UndoHistory::reset);
+    connect(m_grid, &PixelGrid::sizeChanged, this, &UndoHistory::reset);
+  }
+  reset();
+  emit gridChanged(grid);
+}
+
+void UndoHistory::setMemoryBudget(qint64 memoryBudget) {
+  if (m_memoryBudget == memoryBudget) return;
+
+  m_memoryBudget = memoryBudget;
+  trimToBudget();
+  emit memoryBudgetChanged(memoryBudget);
+}
+
+void UndoHistory::recordCells(const QList<int> &cells) {
+  const QByteArray &colors = m_grid->colorPlane();
+  const QByteArray &depths = m_grid->depthPlane();
+  if (m_colors.size() != colors.size()) {
+    reset();
+    return;
+  }
+
+  for (int cell : cells) {
+    quint16 before = packCell(m_colors[cell], m_depths[cell]);
+    quint16 after = packCell(colors[cell], depths[cell]);
+    m_colors[cell] = colors[cell];
+    m_depths[cell] = depths[cell];
+    if (m_applying) continue;
+
+    // a cell painted twice in one stroke keeps its first old value
+    auto open = m_open.find(cell);
+    if (open == m_open.end()) {
+      m_open.insert(cell, qMakePair(before, after));
+    } else {
+      open->second = after;
+    }
+  }
+  if (!m_applying && m_strokeDepth == 0) commitStep();
+}
+
+void UndoHistory::reset() {
+  m_colors = m_grid ? m_grid->colorPlane() : QByteArray();
+  m_depths = m_grid ? m_grid->depthPlane() : QByteArray();
+  m_strokeDepth = 0;
+  clear();
+}
+
+qint64 UndoHistory::Step::size() const {
+  return runs.size() * sizeof(Run) + before.size() + after.size();
+}
+
+void UndoHistory::commitStep() {
+  Step step;
+  for (auto it = m_open.constBegin(); it != m_open.constEnd(); ++it) {
+    quint16 before = it.value().first, after = it.value().second;
+    if (before == after) continue;
+    if (!step.runs.isEmpty() &&
+        step.runs.last().start + step.runs.last().length == it.key()) {
+      ++step.runs.last().length;
+    } else {
+      step.runs.append(Run{it.key(), 1});
+    }
+    step.before.append(char(before >> 8)).append(char(before & 0xff));
+    step.after.append(char(after >> 8)).append(char(after & 0xff));
+  }
+  m_open.clear();
+  if (!step.runs.isEmpty()) pushStep(std::move(step));
+}
+
+void UndoHistory::pushStep(Step &&step) {
+  for (const Step &redo : m_redo) m_memoryUsage -= redo.size();
+  m_redo.clear();
+  m_memoryUsage += step.size();
+  m_undo.append(std::move(step));
+  trimToBudget();
+  emit historyChanged();
+}
+
+void UndoHistory::apply(const Step &step, bool forward) {
+  const QByteArray &values = forward ? step.after : step.before;
+  int count = values.size() / 2;
+  QVector<int> cells;
+  QByteArray colors(count, '\0'), depths(count, '\0');
+  cells.reserve(count);
+  for (const Run &run : step.runs) {
+    for (int i = 0; i < run.length; ++i) {
+      int k = cells.size();
+      cells.append(run.start + i);
+      colors[k] = values[2 * k];
+      depths[k] = values[2 * k + 1];
+    }
+  }
+
+  // the grid reports the change synchronously, it only updates the shadow
+  m_applying = true;
+  m_grid->setCellValues(cells, colors, depths);
+  m_applying = false;
+}
+
+void UndoHistory::trimToBudget() {
+  bool trimmed = false;
+  while (m_memoryUsage > m_memoryBudget && !m_undo.isEmpty()) {
+    m_memoryUsage -= m_undo.takeFirst().size();
+    trimmed = true;
+  }
+  while (m_memoryUsage > m_memoryBudget && !m_redo.isEmpty()) {
+    m_memoryUsage -= m_redo.takeFirst().size();
+    trimmed = true;
+  }
+  if (trimmed) emit historyChanged();
+}
@@ -0,0 +1,88 @@
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+
+#include <QPointer>
+#include <QtCore>
+
+#include "pixelgrid.h"
+
+/* UndoHistory records the edits of a PixelGrid as steps of changed cells.
+ * A step stores runs of consecutive cell indices plus the color and depth
+ * bytes of every cell before and after the edit, so it costs about four
+ * bytes per changed cell and undo or redo only touch those cells.
+ *
+ * Changes reported between beginStroke and endStroke form one step, any
+ * other reported batch becomes a step of its own. The old values come from
+ * a shadow copy of the grid planes kept in sync from cellsChanged. Bulk
+ * changes such as creating or loading a grid start a new history, and the
+ * oldest steps are dropped once memoryUsage exceeds memoryBudget.
+ */
+class UndoHistory : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(UndoHistory)
+  Q_PROPERTY(PixelGrid *grid READ grid WRITE setGrid NOTIFY gridChanged)
+  Q_PROPERTY(bool canUndo READ canUndo NOTIFY historyChanged)
+  Q_PROPERTY(bool canRedo READ canRedo NOTIFY historyChanged)
+  Q_PROPERTY(qint64 memoryUsage READ memoryUsage NOTIFY historyChanged)
+  Q_PROPERTY(qint64 memoryBudget READ memoryBudget WRITE setMemoryBudget
+                 NOTIFY memoryBudgetChanged)
+
+ public:
+  UndoHistory(QObject *parent = 0);
+  ~UndoHistory();
+
+  Q_INVOKABLE void beginStroke();
+  Q_INVOKABLE void endStroke();
+  Q_INVOKABLE void undo();
+  Q_INVOKABLE void redo();
+  Q_INVOKABLE void clear();
+
+  PixelGrid *grid() const;
+  bool canUndo() const;
+  bool canRedo() const;
+  qint64 memoryUsage() const;
+  qint64 memoryBudget() const;
+
+ public slots:
+  void setGrid(PixelGrid *grid);
+  void setMemoryBudget(qint64 memoryBudget);
+
+ signals:
+  void gridChanged(PixelGrid *grid);
+  void historyChanged();
+  void memoryBudgetChanged(qint64 memoryBudget);
+
+ private slots:
+  void recordCells(const QList<int> &cells);
+  void reset();
+
+ private:
+  struct Run {
+    int start;
+    int length;
+  };
+  struct Step {
+    QVector<Run> runs;
+    QByteArray before;  // color and depth byte per cell, in run order
+    QByteArray after;
+    qint64 size() const;
+  };
+
+  void commitStep();
+  void pushStep(Step &&step);
+  void apply(const Step &step, bool forward);
+  void trimToBudget();
+
+  QPointer<PixelGrid> m_grid;
+  QByteArray m_colors;  // shadow planes, the grid as of the last report
+  QByteArray m_depths;
+  QMap<int, QPair<quint16, quint16>> m_open;  // cell -> old, new of a stroke
+  int m_strokeDepth = 0;
+  bool m_applying = false;
+  QList<Step> m_undo;
+  QList<Step> m_redo;
+  qint64 m_memoryUsage = 0;
+  qint64 m_memoryBudget = 64 * 1024 * 1024;
+};
+
+#endif  // UNDOHISTORY_H
@@ -0,0 +1,198 @@
+#include "voxelgeometry.h"
+
+#include <limits>
+
+#include "voxelmesher.h"
+
+namespace {
+// position, normal and rgba color, all as floats
+const int kFloatsPerVertex = 10;
+}  // namespace
+
+VoxelGeometry::VoxelGeometry(QQuick3DObject *parent)
+    : QQuick3DGeometry(parent) {
+  rebuild();
+}
+
+VoxelGeometry::~VoxelGeometry() {}
+
+PixelGrid *VoxelGeometry::grid() const { return m_grid; }
+
+float VoxelGeometry::cellSize() const { return m_cellSize; }
+
+int VoxelGeometry::chunkSize() const { return m_chunkSize; }
+
+int VoxelGeometry::chunkRow() const { return m_chunkRow; }
+
+int VoxelGeometry::chunkCol() const { return m_chunkCol; }
+
+void VoxelGeometry::setGrid(PixelGrid *grid) {
+  if (m_grid == grid) return;
+
+  if (m_grid) disconnect(m_grid, nullptr, this, nullptr);
+  m_grid = grid;
+  if (m_grid) {
+    connect(m_grid, &PixelGrid::cellsChanged, this,
+            &VoxelGeometry::updateCells);
+    connect(m_grid, &PixelGrid::gridChanged, this, &VoxelGeometry::rebuild);
+    connect(m_grid, &PixelGrid::paletteChanged, this, &VoxelGeometry::rebuild);
+  }
+  rebuild();
+  emit gridChanged(grid);
+}
+
+void VoxelGeometry::setCellSize(float cellSize) {
+  if (qFuzzyCompare(m_cellSize, cellSize)) return;
+
+  m_cellSize = cellSize;
+  rebuild();
+  emit cellSizeChanged(cellSize);
+}
+
+void VoxelGeometry::setChunkSize(int chunkSize) {
+  if (m_chunkSize == chunkSize) return;
+
+  m_chunkSize = qMax(0, chunkSize);
+  rebuild();
+  emit chunkChanged();
+}
+
+void VoxelGeometry::setChunkRow(int chunkRow) {
+  if (m_chunkRow == chunkRow) return;
+
+  m_chunkRow = chunkRow;
+  rebuild();
+  emit chunkChanged();
+}
+
+void VoxelGeometry::setChunkCol(int chunkCol) {
+  if (m_chunkCol == chunkCol) return;
+
+  m_chunkCol = chunkCol;
+  rebuild();
+  emit chunkChanged();
+}
+
+void VoxelGeometry::updateCells(const QList<int> &cells) {
+  // a cell next to the chunk decides which of its side faces are visible
+  if (!m_grid) return;
+  QRect area = chunkRect().adjusted(-1, -1, 1, 1);
+  int width = m_grid->width();
+  for (int cell : cells) {
+    if (area.contains(cell % width, cell / width)) {
+      rebuild();
+      return;
+    }
+  }
+}
+
+QRect VoxelGeometry::chunkRect() const {
+  // x is the column, y the row
+  QRect grid(0, 0, m_grid->width(), m_grid->height());
+  if (m_chunkSize == 0) return grid;
+  return QRect(m_chunkCol * m_chunkSize, m_chunkRow * m_chunkSize,
+               m_chunkSize, m_chunkSize)
+      .intersected(grid);
+}
+
+void VoxelGeometry::rebuild() {
+  clear();
+  setStride(kFloatsPerVertex * sizeof(float));
+  setPrimitiveType(QQuick3DGeometry::PrimitiveType::Triangles);
+  addAttribute(QQuick3DGeometry::Attribute::PositionSemantic, 0,
+               QQuick3DGeometry::Attribute::F32Type);
+  addAttribute(QQuick3DGeometry::Attribute::NormalSemantic, 3 * sizeof(float),
+               QQuick3DGeometry::Attribute::F32Type);
+  addAttribute(QQuick3DGeometry::Attribute::ColorSemantic, 6 * sizeof(float),
+               QQuick3DGeometry::Attribute::F32Type);
+  addAttribute(QQuick3DGeometry::Attribute::IndexSemantic, 0,
+               QQuick3DGeometry::Attribute::U32Type);
+
+  QRect chunk = m_grid ? chunkRect() : QRect();
+  if (chunk.isEmpty()) {
+    setBounds(QVector3D(), QVector3D());
+    update();
+    return;
+  }
+
+  /* copy the chunk and a one cell ring around it out of the grid, cells
+   * outside of the grid stay empty
+   */
+  int width = m_grid->width();
+  int height = m_grid->height();
+  int windowWidth = chunk.width() + 2;
+  int windowHeight = chunk.height() + 2;
+  const QByteArray &colorPlane = m_grid->colorPlane();
+  const QByteArray &depthPlane = m_grid->depthPlane();
+  QVector<int> materials(windowWidth * windowHeight, -1);
+  QVector<int> depths(windowWidth * windowHeight, 0);
+  for (int row = 0; row < windowHeight; ++row) {
+    int gridRow = chunk.top() + row - 1;
+    if (gridRow < 0 || gridRow >= height) continue;
+    for (int col = 0; col < windowWidth; ++col) {
+      int gridCol = chunk.left() + col - 1;
+      if (gridCol < 0 || gridCol >= width) continue;
+      int cell = gridRow * width + gridCol;
+      materials[row * windowWidth + col] = int(quint8(colorPlane[cell])) - 1;
+      depths[row * windowWidth + col] = quint8(depthPlane[cell]);
+    }
+  }
+
+  VoxelMesher mesher(windowWidth, windowHeight, materials, depths);
+  mesher.setDepthExtent(0.5f, 0.0f);
+  mesher.setWindow(chunk.top() - 1, chunk.left() - 1, height);
+  QVector<VoxelMesher::Face> faces = mesher.faces();
+
+  /* the mesher works in cells with row 0 on top, shift it so cell centers
+   * land where Cube.qml used to place them
+   */
+  QVector3D offset(-(width + 1) / 2.0f, -(height - 1) / 2.0f, 0.0f);
+
+  QByteArray vertexData(faces.size() * 4 * kFloatsPerVertex * sizeof(float),
+                        Qt::Uninitialized);
+  QByteArray indexData(faces.size() * 6 * sizeof(quint32), Qt::Uninitialized);
+  float *vertex = reinterpret_cast<float *>(vertexData.data());
+  quint32 *index = reinterpret_cast<quint32 *>(indexData.data());
+  const float inf = std::numeric_limits<float>::infinity();
+  QVector3D minBound(inf, inf, inf), maxBound(-inf, -inf, -inf);
+
+  for (int i = 0; i < faces.size(); ++i) {
+    const VoxelMesher::Face &face = faces[i];
+    QColor color = m_grid->paletteColor(face.material);
+    const QVector3D corners[4] = {face.origin, face.origin + face.u,
+                                  face.origin + face.u + face.v,
+                                  face.origin + face.v};
+    for (const QVector3D &corner : corners) {
+      QVector3D position = (corner + offset) * m_cellSize;
+      minBound = QVector3D(qMin(minBound.x(), position.x()),
+                           qMin(minBound.y(), position.y()),
+                           qMin(minBound.z(), position.z()));
+      maxBound = QVector3D(qMax(maxBound.x(), position.x()),
+                           qMax(maxBound.y(), position.y()),
+                           qMax(maxBound.z(), position.z()));
+      *vertex++ = position.x();
+      *vertex++ = position.y();
+      *vertex++ = position.z();
+      *vertex++ = face.normal.x();
+      *vertex++ = face.normal.y();
+      *vertex++ = face.normal.z();
+      *vertex++ = color.redF();
+      *vertex++ = color.greenF();
+      *vertex++ = color.blueF();
+      *vertex++ = 1.0f;
+    }
+    quint32 base = i * 4;
+    *index++ = base;
+    *index++ = base + 1;
+    *index++ = base + 2;
+    *index++ = base;
+    *index++ = base + 2;
+    *index++ = base + 3;
+  }
+
+  setVertexData(vertexData);
+  setIndexData(indexData);
+  if (faces.isEmpty()) minBound = maxBound = QVector3D();
+  setBounds(minBound, maxBound);
+  update();
+}
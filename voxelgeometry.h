@@ -0,0 +1,68 @@
+#ifndef VOXELGEOMETRY_H
+#define VOXELGEOMETRY_H
+
+#include <QPointer>
+#include <QtQuick3D/QQuick3DGeometry>
+
+#include "pixelgrid.h"
+
+/* VoxelGeometry renders a whole PixelGrid as one mesh: only the faces not
+ * hidden by a neighbour are generated and every vertex carries the color of
+ * its cell, so a single Model with vertex colors draws the complete grid.
+ *
+ * The layout matches the old per pixel Cube.qml instances: cells are
+ * cellSize apart, centered the same way, and extrude cellSize / 2 * depth
+ * to both sides of z = 0.
+ *
+ * With chunkSize set the geometry only covers the chunkSize x chunkSize
+ * block at (chunkRow, chunkCol), so a large grid can be drawn by one model
+ * per chunk and an edit only rebuilds the chunks whose cells, or border
+ * cells, changed.
+ */
+class VoxelGeometry : public QQuick3DGeometry {
+  Q_OBJECT
+  Q_PROPERTY(PixelGrid *grid READ grid WRITE setGrid NOTIFY gridChanged)
+  Q_PROPERTY(float cellSize READ cellSize WRITE setCellSize NOTIFY
+                 cellSizeChanged)
+  Q_PROPERTY(int chunkSize READ chunkSize WRITE setChunkSize NOTIFY
+                 chunkChanged)
+  Q_PROPERTY(int chunkRow READ chunkRow WRITE setChunkRow NOTIFY chunkChanged)
+  Q_PROPERTY(int chunkCol READ chunkCol WRITE setChunkCol NOTIFY chunkChanged)
+
+ public:
+  explicit VoxelGeometry(QQuick3DObject *parent = nullptr);
+  ~VoxelGeometry();
+
+  PixelGrid *grid() const;
+  float cellSize() const;
+  int chunkSize() const;
+  int chunkRow() const;
+  int chunkCol() const;
+
+ public slots:
+  void setGrid(PixelGrid *grid);
+  void setCellSize(float cellSize);
+  void setChunkSize(int chunkSize);
+  void setChunkRow(int chunkRow);
+  void setChunkCol(int chunkCol);
+
+ signals:
+  void gridChanged(PixelGrid *grid);
+  void cellSizeChanged(float cellSize);
+  void chunkChanged();
+
+ private slots:
+  void rebuild();
+  void updateCells(const QList<int> &cells);
+
+ private:
+  QRect chunkRect() const;
+
+  QPointer<PixelGrid> m_grid;
+  float m_cellSize = 50.0f;
+  int m_chunkSize = 0;  // 0 covers the whole grid
+  int m_chunkRow = 0;
+  int m_chunkCol = 0;
+};
+
+#endif  // VOXELGEOMETRY_H
@@ -0,0 +1,105 @@
+#include "voxelinstancing.h"
+
+VoxelInstancing::VoxelInstancing(QQuick3DObject *parent)
+    : QQuick3DInstancing(parent) {}
+
+VoxelInstancing::~VoxelInstancing() {}
+
+PixelGrid *VoxelInstancing::grid() const { return m_grid; }
+
+float VoxelInstancing::cellSize() const { return m_cellSize; }
+
+void VoxelInstancing::setGrid(PixelGrid *grid) {
+  if (m_grid == grid) return;
+
+  if (m_grid) disconnect(m_grid, nullptr, this, nullptr);
+  m_grid = grid;
+  if (m_grid) {
+    connect(m_grid, &PixelGrid::cellsChanged, this,
+            &VoxelInstancing::updateCells);
+    connect(m_grid, &PixelGrid::gridChanged, this, &VoxelInstancing::rebuild);
+    connect(m_grid, &PixelGrid::paletteChanged, this,
+            &VoxelInstancing::rebuild);
+  }
+  rebuild();
+  emit gridChanged(grid);
+}
+
+void VoxelInstancing::setCellSize(float cellSize) {
+  if (qFuzzyCompare(m_cellSize, cellSize)) return;
+
+  m_cellSize = cellSize;
+  rebuild();
+  emit cellSizeChanged(cellSize);
+}
+
+QByteArray VoxelInstancing::getInstanceBuffer(int *instanceCount) {
+  if (instanceCount) *instanceCount = m_cells.size();
+  return m_table;
+}
+
+void VoxelInstancing::rebuild() {
+  m_table.clear();
+  m_cells.clear();
+  m_slots.clear();
+  if (m_grid) {
+    m_slots.fill(-1, m_grid->width() * m_grid->height());
+    for (int cell = 0; cell < m_slots.size(); ++cell) updateCell(cell);
+  }
+  markDirty();
+}
+
+void VoxelInstancing::updateCells(const QList<int> &cells) {
+  if (!m_grid || m_slots.size() != m_grid->width() * m_grid->height()) {
+    rebuild();
+    return;
+  }
+  for (int cell : cells) updateCell(cell);
+  markDirty();
+}
+
+QQuick3DInstancing::InstanceTableEntry VoxelInstancing::entryAt(
+    int cell) const {
+  // same placement and scale the per pixel Cube.qml instances used
+  int width = m_grid->width();
+  int row = cell / width;
+  int col = cell % width;
+  QVector3D position((col - width / 2.0f) * m_cellSize,
+                     (m_grid->height() / 2.0f - row) * m_cellSize, 0.0f);
+  float halfSize = m_cellSize / 2.0f;
+  QVector3D scale(halfSize, halfSize, halfSize * m_grid->depth(row, col));
+  QColor color = m_grid->paletteColor(m_grid->colorIndex(row, col));
+  return calculateTableEntry(position, scale, QVector3D(), color);
+}
+
+QQuick3DInstancing::InstanceTableEntry *VoxelInstancing::entries() {
+  return reinterpret_cast<InstanceTableEntry *>(m_table.data());
+}
+
+void VoxelInstancing::updateCell(int cell) {
+  int slot = m_slots[cell];
+  int width = m_grid->width();
+  if (m_grid->isEmpty(cell / width, cell % width)) {
+    if (slot < 0) return;
+    // move the last entry into the hole so the table stays packed
+    int last = m_cells.size() - 1;
+    if (slot != last) {
+      entries()[slot] = entries()[last];
+      m_cells[slot] = m_cells[last];
+      m_slots[m_cells[slot]] = slot;
+    }
+    m_cells.removeLast();
+    m_table.chop(sizeof(InstanceTableEntry));
+    m_slots[cell] = -1;
+    return;
+  }
+
+  InstanceTableEntry entry = entryAt(cell);
+  if (slot >= 0) {
+    entries()[slot] = entry;
+  } else {
+    m_slots[cell] = m_cells.size();
+    m_cells.append(cell);
+    m_table.append(reinterpret_cast<const char *>(&entry), sizeof(entry));
+  }
+}
@@ -0,0 +1,56 @@
+#ifndef VOXELINSTANCING_H
+#define VOXELINSTANCING_H
+
+#include <QPointer>
+#include <QtQuick3D/QQuick3DInstancing>
+
+#include "pixelgrid.h"
+
+/* VoxelInstancing feeds an instanced cube Model straight from a PixelGrid,
+ * one table entry per painted cell holding its position, depth scale and
+ * color. Entries are packed without gaps; m_slots maps a cell to its entry
+ * so an edit only rewrites, appends or swap removes the affected records.
+ *
+ * The instanced mesh is expected to span [-1, 1] like cube.mesh.
+ */
+class VoxelInstancing : public QQuick3DInstancing {
+  Q_OBJECT
+  Q_PROPERTY(PixelGrid *grid READ grid WRITE setGrid NOTIFY gridChanged)
+  Q_PROPERTY(float cellSize READ cellSize WRITE setCellSize NOTIFY
+                 cellSizeChanged)
+
+ public:
+  explicit VoxelInstancing(QQuick3DObject *parent = nullptr);
+  ~VoxelInstancing();
+
+  PixelGrid *grid() const;
+  float cellSize() const;
+
+ public slots:
+  void setGrid(PixelGrid *grid);
+  void setCellSize(float cellSize);
+
+ signals:
+  void gridChanged(PixelGrid *grid);
+  void cellSizeChanged(float cellSize);
+
+ protected:
+  QByteArray getInstanceBuffer(int *instanceCount) override;
+
+ private slots:
+  void rebuild();
+  void updateCells(const QList<int> &cells);
+
+ private:
+  InstanceTableEntry entryAt(int cell) const;
+  InstanceTableEntry *entries();
+  void updateCell(int cell);
+
+  QPointer<PixelGrid> m_grid;
+  float m_cellSize = 50.0f;
+  QByteArray m_table;
+  QVector<int> m_slots;  // per cell, -1 when the cell has no entry
+  QVector<int> m_cells;  // per entry, the cell it draws
+};
+
+#endif  // VOXELINSTANCING_H
@@ -0,0 +1,228 @@
+#include "voxelmesher.h"
+
+VoxelMesher::VoxelMesher(int width, int height, const QVector<int> &materials,
+                         const QVector<int> &depths)
+    : m_width(width),
+      m_height(height),
+      m_materials(materials),
+      m_depths(depths),
+      m_gridHeight(height) {}
+
+void VoxelMesher::setDepthExtent(float depthScale, float depthBias) {
+  m_depthScale = depthScale;
+  m_depthBias = depthBias;
+}
+
+void VoxelMesher::setWindow(int row, int col, int gridHeight) {
+  // (row, col) is the grid position of the first, context only, cell
+  m_border = 1;
+  m_rowOffset = row;
+  m_colOffset = col;
+  m_gridHeight = gridHeight;
+}
+
+QVector<VoxelMesher::Face> VoxelMesher::faces() const {
+  QVector<Face> faces;
+  for (int row = m_border; row < m_height - m_border; ++row) {
+    for (int col = m_border; col < m_width - m_border; ++col) {
+      int material = materialAt(row, col);
+      if (material < 0) continue;
+      float halfDepth = halfDepthAt(row, col);
+      float x0 = col + m_colOffset, x1 = x0 + 1;
+      float y1 = m_gridHeight - row - m_rowOffset, y0 = y1 - 1;
+
+      // front and back faces are never shared, there is only one layer
+      faces.append(Face{material, QVector3D(x0, y0, halfDepth),
+                        QVector3D(1, 0, 0), QVector3D(0, 1, 0),
+                        QVector3D(0, 0, 1)});
+      faces.append(Face{material, QVector3D(x0, y0, -halfDepth),
+                        QVector3D(0, 1, 0), QVector3D(1, 0, 0),
+                        QVector3D(0, 0, -1)});
+
+      appendSideFaces(faces, material, halfDepth, halfDepthAt(row, col + 1),
+                      QVector3D(x1, y0, 0), QVector3D(0, 1, 0),
+                      QVector3D(1, 0, 0), false);
+      appendSideFaces(faces, material, halfDepth, halfDepthAt(row, col - 1),
+                      QVector3D(x0, y0, 0), QVector3D(0, 1, 0),
+                      QVector3D(-1, 0, 0), true);
+      appendSideFaces(faces, material, halfDepth, halfDepthAt(row - 1, col),
+                      QVector3D(x0, y1, 0), QVector3D(1, 0, 0),
+                      QVector3D(0, 1, 0), true);
+      appendSideFaces(faces, material, halfDepth, halfDepthAt(row + 1, col),
+                      QVector3D(x0, y0, 0), QVector3D(1, 0, 0),
+                      QVector3D(0, -1, 0), false);
+    }
+  }
+  return faces;
+}
+
+QVector<VoxelMesher::Face> VoxelMesher::greedyFaces() const {
+  /* same visible surface as faces(), but coplanar faces with the same
+   * material and depth are merged into maximal rectangles
+   */
+  QVector<Face> faces;
+  appendGreedyCaps(faces);
+  appendGreedyWalls(faces);
+  return faces;
+}
+
+bool VoxelMesher::Wall::operator==(const Wall &other) const {
+  return visible == other.visible && material == other.material &&
+         halfDepth == other.halfDepth &&
+         neighbourHalfDepth == other.neighbourHalfDepth;
+}
+
+VoxelMesher::Wall VoxelMesher::wallAt(int row, int col, int dRow,
+                                      int dCol) const {
+  int material = materialAt(row, col);
+  if (material < 0) return Wall{false, -1, 0.0f, 0.0f};
+  float halfDepth = halfDepthAt(row, col);
+  float neighbourHalfDepth = halfDepthAt(row + dRow, col + dCol);
+  return Wall{neighbourHalfDepth < halfDepth, material, halfDepth,
+              neighbourHalfDepth};
+}
+
+void VoxelMesher::appendGreedyCaps(QVector<Face> &faces) const {
+  /* front and back faces of cells with the same material and depth lie in
+   * the same plane, grow each one first along the row and then downwards
+   * as long as every cell of the next row matches
+   */
+  QVector<bool> used(m_width * m_height, false);
+  auto matches = [&](int row, int col, int material, int depth) {
+    int index = row * m_width + col;
+    return !used[index] && m_materials[index] == material &&
+           m_depths[index] == depth;
+  };
+
+  for (int row = m_border; row < m_height - m_border; ++row) {
+    for (int col = m_border; col < m_width - m_border; ++col) {
+      int material = materialAt(row, col);
+      if (material < 0 || used[row * m_width + col]) continue;
+      int depth = m_depths[row * m_width + col];
+
+      int width = 1;
+      while (col + width < m_width - m_border &&
+             matches(row, col + width, material, depth))
+        ++width;
+      int height = 1;
+      while (row + height < m_height - m_border) {
+        bool rowMatches = true;
+        for (int k = 0; k < width && rowMatches; ++k)
+          rowMatches = matches(row + height, col + k, material, depth);
+        if (!rowMatches) break;
+        ++height;
+      }
+
+      for (int i = row; i < row + height; ++i)
+        for (int j = col; j < col + width; ++j) used[i * m_width + j] = true;
+
+      float halfDepth = halfDepthAt(row, col);
+      float x0 = col + m_colOffset;
+      float y0 = m_gridHeight - row - m_rowOffset - height;
+      faces.append(Face{material, QVector3D(x0, y0, halfDepth),
+                        QVector3D(width, 0, 0), QVector3D(0, height, 0),
+                        QVector3D(0, 0, 1)});
+      faces.append(Face{material, QVector3D(x0, y0, -halfDepth),
+                        QVector3D(0, height, 0), QVector3D(width, 0, 0),
+                        QVector3D(0, 0, -1)});
+    }
+  }
+}
+
+void VoxelMesher::appendGreedyWalls(QVector<Face> &faces) const {
+  /* every grid line between two columns (or rows) is a slab holding the
+   * side walls facing one direction. consecutive cells along the slab whose
+   * walls have the same material and the same visible z ranges are merged
+   */
+  struct Direction {
+    int dRow;
+    int dCol;
+    QVector3D normal;
+    bool zAlongU;
+  };
+  const Direction directions[] = {{0, 1, QVector3D(1, 0, 0), false},
+                                  {0, -1, QVector3D(-1, 0, 0), true},
+                                  {-1, 0, QVector3D(0, 1, 0), true},
+                                  {1, 0, QVector3D(0, -1, 0), false}};
+
+  for (const Direction &direction : directions) {
+    // walls facing along x run down a column, walls facing along y along a row
+    bool alongColumn = direction.dRow == 0;
+    int slabs = alongColumn ? m_width : m_height;
+    int length = alongColumn ? m_height : m_width;
+    auto wall = [&](int slab, int i) {
+      return alongColumn ? wallAt(i, slab, direction.dRow, direction.dCol)
+                         : wallAt(slab, i, direction.dRow, direction.dCol);
+    };
+
+    for (int slab = m_border; slab < slabs - m_border; ++slab) {
+      int start = m_border;
+      while (start < length - m_border) {
+        Wall current = wall(slab, start);
+        if (!current.visible) {
+          ++start;
+          continue;
+        }
+        int end = start + 1;
+        while (end < length - m_border && wall(slab, end) == current) ++end;
+
+        int count = end - start;
+        QVector3D origin, u;
+        if (alongColumn) {
+          float x = (direction.dCol > 0 ? slab + 1 : slab) + m_colOffset;
+          origin = QVector3D(x, m_gridHeight - end - m_rowOffset, 0);
+          u = QVector3D(0, count, 0);
+        } else {
+          float y = m_gridHeight - slab - m_rowOffset;
+          if (direction.dRow > 0) y -= 1;
+          origin = QVector3D(start + m_colOffset, y, 0);
+          u = QVector3D(count, 0, 0);
+        }
+        appendSideFaces(faces, current.material, current.halfDepth,
+                        current.neighbourHalfDepth, origin, u,
+                        direction.normal, direction.zAlongU);
+        start = end;
+      }
+    }
+  }
+}
+
+int VoxelMesher::materialAt(int row, int col) const {
+  if (row < 0 || row >= m_height || col < 0 || col >= m_width) return -1;
+  return m_materials[row * m_width + col];
+}
+
+float VoxelMesher::halfDepthAt(int row, int col) const {
+  // empty and out of grid cells hide nothing
+  if (materialAt(row, col) < 0) return 0.0f;
+  return m_depths[row * m_width + col] * m_depthScale + m_depthBias;
+}
+
+void VoxelMesher::appendSideFaces(QVector<Face> &faces, int material,
+                                  float halfDepth, float neighbourHalfDepth,
+                                  const QVector3D &origin, const QVector3D &u,
+                                  const QVector3D &normal,
+                                  bool zAlongU) const {
+  /* the neighbour covers [-neighbourHalfDepth, neighbourHalfDepth], so only
+   * the parts of this side that stick out in front and behind it are visible
+   */
+  if (neighbourHalfDepth >= halfDepth) return;
+
+  QVector<QPair<float, float>> ranges;
+  if (neighbourHalfDepth <= 0.0f) {
+    ranges.append(qMakePair(-halfDepth, halfDepth));
+  } else {
+    ranges.append(qMakePair(neighbourHalfDepth, halfDepth));
+    ranges.append(qMakePair(-halfDepth, -neighbourHalfDepth));
+  }
+
+  for (const auto &range : ranges) {
+    QVector3D faceOrigin = origin + QVector3D(0, 0, range.first);
+    QVector3D extrusion(0, 0, range.second - range.first);
+    if (zAlongU) {
+      faces.append(Face{material, faceOrigin, extrusion, u, normal});
+    } else {
+      faces.append(Face{material, faceOrigin, u, extrusion, normal});
+    }
+  }
+}
@@ -0,0 +1,70 @@
+#ifndef VOXELMESHER_H
+#define VOXELMESHER_H
+
+#include <QVector3D>
+#include <QtCore>
+
+/* VoxelMesher turns a grid of extruded cells into the set of faces that are
+ * actually visible. Every painted cell is a box centered on z = 0 whose half
+ * depth is depthScale * depth + depthBias, so a side face is only hidden in
+ * the z range covered by its neighbour.
+ *
+ * Faces are produced in cell units: column c spans x in [c, c + 1] and row r
+ * spans y in [height - r - 1, height - r], so row 0 is at the top and the
+ * model faces +z. Callers scale and translate the result to their own space.
+ *
+ * Large grids can be meshed in pieces with setWindow: the cells passed in
+ * are then a window of the full grid including a one cell ring around it,
+ * the ring is only consulted for culling and faces keep grid coordinates.
+ */
+class VoxelMesher {
+ public:
+  struct Face {
+    int material;
+    QVector3D origin;
+    QVector3D u;  // corners are origin, origin + u, origin + u + v, origin + v
+    QVector3D v;  // u x v points along normal
+    QVector3D normal;
+  };
+
+  VoxelMesher(int width, int height, const QVector<int> &materials,
+              const QVector<int> &depths);
+
+  void setDepthExtent(float depthScale, float depthBias);
+  void setWindow(int row, int col, int gridHeight);
+
+  QVector<Face> faces() const;
+  QVector<Face> greedyFaces() const;
+
+ private:
+  struct Wall {
+    bool visible;
+    int material;
+    float halfDepth;
+    float neighbourHalfDepth;
+    bool operator==(const Wall &other) const;
+  };
+
+  Wall wallAt(int row, int col, int dRow, int dCol) const;
+  void appendGreedyCaps(QVector<Face> &faces) const;
+  void appendGreedyWalls(QVector<Face> &faces) const;
+  int materialAt(int row, int col) const;
+  float halfDepthAt(int row, int col) const;
+  void appendSideFaces(QVector<Face> &faces, int material, float halfDepth,
+                       float neighbourHalfDepth, const QVector3D &origin,
+                       const QVector3D &u, const QVector3D &normal,
+                       bool zAlongU) const;
+
+  int m_width;
+  int m_height;
+  QVector<int> m_materials;  // row major, -1 for empty cells
+  QVector<int> m_depths;
+  float m_depthScale = 1.0f;
+  float m_depthBias = 0.0f;
+  int m_border = 0;  // rings of context cells that are not meshed
+  int m_rowOffset = 0;
+  int m_colOffset = 0;
+  int m_gridHeight;
+};
+
+#endif  // VOXELMESHER_H
@@ -0,0 +1,57 @@
+#include "workstealingpool.h"
+
+WorkStealingPool::WorkStealingPool(int threadCount) {
+  for (int i = 0; i < qMax(1, threadCount); ++i)
+    m_queues.emplace_back(new Queue);
+}
+
+void WorkStealingPool::add(Task task) {
+  Queue &queue = *m_queues[m_next];
+  m_next = (m_next + 1) % m_queues.size();
+  QMutexLocker locker(&queue.mutex);
+  queue.tasks.push_back(std::move(task));
+}
+
+void WorkStealingPool::run() {
+  // the calling thread works as well, it would only wait otherwise
+  QVector<QThread *> threads;
+  for (int worker = 1; worker < threadCount(); ++worker) {
+    threads.append(QThread::create([this, worker]() { work(worker); }));
+    threads.last()->start();
+  }
+  work(0);
+  for (QThread *thread : threads) {
+    thread->wait();
+    delete thread;
+  }
+}
+
+int WorkStealingPool::threadCount() const { return int(m_queues.size()); }
+
+bool WorkStealingPool::take(int worker, Task &task) {
+  Queue &own = *m_queues[worker];
+  {
+    QMutexLocker locker(&own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  // steal the oldest task, the owner works on the other end
+  for (int offset = 1; offset < threadCount(); ++offset) {
+    Queue &victim = *m_queues[(worker + offset) % threadCount()];
+    QMutexLocker locker(&victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::work(int worker) {
+  Task task;
+  while (take(worker, task)) task();
+}
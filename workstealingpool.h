@@ -0,0 +1,43 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <QtCore>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/* WorkStealingPool runs a batch of independent tasks on one thread per
+ * core. The tasks are dealt out round robin and every worker owns a deque
+ * of them: it takes its own tasks from the back and, once that runs dry,
+ * steals from the front of the other deques. A worker that drew a few big
+ * projects therefore doesn't leave the rest of the batch waiting on it.
+ *
+ * Tasks can't add new tasks, the pool is done once every deque is empty.
+ */
+class WorkStealingPool {
+ public:
+  using Task = std::function<void()>;
+
+  explicit WorkStealingPool(int threadCount = QThread::idealThreadCount());
+
+  void add(Task task);
+  // runs all added tasks and returns once they are finished
+  void run();
+
+  int threadCount() const;
+
+ private:
+  struct Queue {
+    QMutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool take(int worker, Task &task);
+  void work(int worker);
+
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  int m_next = 0;  // queue the next added task goes to
+};
+
+#endif  // WORKSTEALINGPOOL_H